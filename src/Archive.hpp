@@ -2,11 +2,19 @@
 
 //
 // ゲーム内記録
+//   記録はArchiveDataのメンバを直接読み書きする
+//   save()や記録の変更はフレームごとにまとめ、別スレッドで書き出す
+//   全てのプレイ結果はGameHistoryに追記し、ここにはランキングだけを持つ
 //
 
 #include <boost/noncopyable.hpp>
+#include <fstream>
+#include <iterator>
 #include "Score.hpp"
 #include "TextCodec.hpp"
+#include "AsyncFileWriter.hpp"
+#include "ArchiveData.hpp"
+#include "GameHistory.hpp"
 
 
 namespace ngs {
@@ -14,282 +22,309 @@ namespace ngs {
 class Archive
   : private boost::noncopyable
 {
-  void create() noexcept
+  static std::string readFile(const ci::fs::path& path) noexcept
   {
-    uint32_t high_score = 500;
-
-    auto games = ci::JsonTree::makeArray("games");
-    // FIXME 初期ランクがハードコーディング
-    auto g = ci::JsonTree::makeObject().addChild(ci::JsonTree("score", uint32_t(high_score)))
-                                       .addChild(ci::JsonTree("rank",  uint32_t(0)))
-    ;
-    
-    for (int i = 0; i < 10; ++i)
-    {
-      games.pushBack(g);
-    }
-
-    records_.addChild(ci::JsonTree("play-times",         uint32_t(0)))
-            .addChild(ci::JsonTree("high-score",         uint32_t(high_score)))
-            .addChild(ci::JsonTree("total-panels",       uint32_t(0)))
-            .addChild(ci::JsonTree("panel-turned-times", uint32_t(0)))
-            .addChild(ci::JsonTree("panel-moved-times",  uint32_t(0)))
-            .addChild(ci::JsonTree("share-times",        uint32_t(0)))
-            .addChild(ci::JsonTree("startup-times",      uint32_t(0)))
-            .addChild(ci::JsonTree("abort-times",        uint32_t(0)))
-
-            .addChild(ci::JsonTree("max-panels", uint32_t(0)))
-            .addChild(ci::JsonTree("max-forest", uint32_t(0)))
-            .addChild(ci::JsonTree("max-path",   uint32_t(0)))
-
-            .addChild(ci::JsonTree("average-score",       0.0))
-            .addChild(ci::JsonTree("average-put-panels",  0.0))
-            .addChild(ci::JsonTree("average-moved-times", 0.0))
-            .addChild(ci::JsonTree("average-turn-times",  0.0))
-            .addChild(ci::JsonTree("average-put-time",    0.0))
-
-            .addChild(ci::JsonTree("bgm-enable", true))
-            .addChild(ci::JsonTree("se-enable",  true))
-
-            .addChild(games)
-            .addChild(ci::JsonTree("saved", false))
-
-            .addChild(ci::JsonTree("version", version_))
-    ;
+    std::ifstream fstr(path.string(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
   }
 
-  void load()
+  // 以前のJSON形式から移行する
+  bool importJson(const ci::fs::path& path) noexcept
   {
-    if (!ci::fs::is_regular_file(full_path_))
-    {
-      // 記録ファイルが無い
-      create();
-      DOUT << "Archive:create: " << full_path_ << std::endl;
-      return;
-    }
-
-#if defined(OBFUSCATION_ARCHIVE)
-    auto text = TextCodec::load(full_path_.string());
     try
     {
-      records_ = ci::JsonTree(text);
+#if defined(OBFUSCATION_ARCHIVE)
+      ci::JsonTree json(TextCodec::load(path.string()));
+#else
+      ci::JsonTree json(ci::loadFile(path));
+#endif
+      data_.fromJson(json);
     }
     catch (ci::JsonTree::ExcJsonParserError&)
     {
       DOUT << "Archive broken." << std::endl;
-      create();
+      return false;
     }
-#else
+
+    DOUT << "Archive:import: " << path << std::endl;
+    return true;
+  }
+
+  // 読めなかった記録を退避
+  // TIPS 新しいバージョンの記録を初期値で上書きしないように
+  void backup() noexcept
+  {
+    auto path = full_path_;
+    path += ".bak";
     try
     {
-      records_ = ci::JsonTree(ci::loadFile(full_path_));
+      ci::fs::rename(full_path_, path);
+      DOUT << "Archive:backup: " << path << std::endl;
     }
-    catch (ci::JsonTree::ExcJsonParserError&)
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+    }
+  }
+
+  void load() noexcept
+  {
+    if (ci::fs::is_regular_file(full_path_))
     {
+      // TIPS 難読化の有無はデータを見て判断する
+      auto data = readFile(full_path_);
+      if (!ArchiveData::isBinary(data))
+      {
+        data = TextCodec::decode(data);
+      }
+
+      if (data_.deserialize(data))
+      {
+        DOUT << "Archive:load: " << full_path_ << std::endl;
+        return;
+      }
       DOUT << "Archive broken." << std::endl;
-      create();
+      backup();
     }
-#endif
-    DOUT << "Archive:load: " << full_path_ << std::endl;
+
+    data_ = ArchiveData(version_);
+
+    auto json_path = full_path_;
+    json_path.replace_extension("json");
+    if (ci::fs::is_regular_file(json_path) && importJson(json_path))
+    {
+      // 新しい形式で書き出しておく
+      dirty_ = true;
+      return;
+    }
+
+    // 記録ファイルが無い
+    DOUT << "Archive:create: " << full_path_ << std::endl;
   }
 
 
 public:
   Archive(const std::string& path, const std::string& version) noexcept
     : full_path_(getDocumentPath() / path),
-      version_(version)
+      version_(version),
+      history_(full_path_.parent_path() / "history", writer_)
   {
     this->load();
   }
 
-  ~Archive() = default;
+  ~Archive()
+  {
+    flush();
+  }
+
+
+  // 記録を参照
+  const ArchiveData& get() const noexcept
+  {
+    return data_;
+  }
+
+  // 記録を変更
+  // NOTICE 呼ぶだけで保存対象になる
+  ArchiveData& modify() noexcept
+  {
+    dirty_ = true;
+    return data_;
+  }
 
 
   // Gameの記録が保存されているか？
   bool isSaved() const noexcept
   {
-    return getRecord<bool>("saved");
+    return data_.saved;
   }
 
   // ランキングデータがあるか
-  bool existsRanking() const
+  bool existsRanking() const noexcept
   {
-    const auto& games = records_["games"];
-    return std::any_of(std::begin(games), std::end(games),
-                       [](const auto& it)
-                       {
-                         return it.hasChild("path");
-                       });
+    return countRanking() > 0;
   }
 
   // 記録されている数を調べる
-  int countRanking() const
+  int countRanking() const noexcept
+  {
+    return int(std::count_if(data_.games, data_.games + data_.game_num,
+                             [](const ArchiveData::Game& g) noexcept
+                             {
+                               return g.path[0] != '\0';
+                             }));
+  }
+
+  // ランキング(スコアの高い順)
+  std::vector<ArchiveData::Game> getGames() const noexcept
+  {
+    return { data_.games, data_.games + data_.game_num };
+  }
+
+  // プレイ履歴
+  GameHistory& history() noexcept
+  {
+    return history_;
+  }
+
+  const GameHistory& history() const noexcept
+  {
+    return history_;
+  }
+
+  // ランキングに追加
+  //   path: GameHistoryの識別子(以前の記録はファイルのパス)
+  //   同じスコアなら新しい方が上
+  // 戻り値:ランキング圏外になった記録のパス
+  std::vector<std::string> addGame(uint32_t score, uint32_t rank, const std::string& path, size_t ranking_records) noexcept
   {
-    const auto& games = records_["games"];
-    return (int)std::count_if(std::begin(games), std::end(games),
-                              [](const auto& it)
-                              {
-                                return it.hasChild("path");
-                              });
+    auto games = getGames();
+    ArchiveData::Game game{ score, rank };
+    ArchiveData::setString(game.path, path);
+    games.insert(std::begin(games), game);
+    std::stable_sort(std::begin(games), std::end(games),
+                     [](const ArchiveData::Game& a, const ArchiveData::Game& b) noexcept
+                     {
+                       return a.score > b.score;
+                     });
+
+    std::vector<std::string> removed;
+    auto num = std::min({ games.size(), ranking_records, size_t(ArchiveData::RANKING_MAX) });
+    for (size_t i = num; i < games.size(); ++i)
+    {
+      if (games[i].path[0]) removed.push_back(games[i].path);
+    }
+
+    auto& data = modify();
+    data.game_num = uint32_t(num);
+    std::copy(std::begin(games), std::begin(games) + num, data.games);
+
+    return removed;
   }
 
   // プレイ結果を記録
   void recordGameResults(const Score& score, bool high_score) noexcept
   {
+    auto& data = modify();
+
     // 累積記録
-    addRecord("play-times",   uint32_t(1));
-    addRecord("total-panels", uint32_t(score.total_panels));
-    addRecord("panel-turned-times", uint32_t(score.panel_turned_times));
-    addRecord("panel-moved-times",  uint32_t(score.panel_moved_times));
+    data.play_times         += 1;
+    data.total_panels       += score.total_panels;
+    data.panel_turned_times += score.panel_turned_times;
+    data.panel_moved_times  += score.panel_moved_times;
 
     if (high_score)
     {
-      setRecord("high-score", uint32_t(score.total_score));
+      data.high_score = score.total_score;
     }
 
-    {
-      // 最大設置数
-      auto record = getRecord<uint32_t>("max-panels");
-      setRecord("max-panels", std::max(record, score.total_panels));
-    }
+    // 最大設置数
+    data.max_panels = std::max(data.max_panels, uint32_t(score.total_panels));
     {
       // 最大規模の森
-      auto record = getRecord<uint32_t>("max-forest");
       auto it    = std::max_element(std::begin(score.forest), std::end(score.forest));
       auto value = uint32_t(it != std::end(score.forest) ? *it : 0);
-      setRecord("max-forest", std::max(record, value));
+      data.max_forest = std::max(data.max_forest, value);
     }
     {
       // 道最大長
-      auto record = getRecord<uint32_t>("max-path");
       auto it    = std::max_element(std::begin(score.path), std::end(score.path));
       auto value = uint32_t(it != std::end(score.path) ? *it : 0);
-      setRecord("max-path", std::max(record, value));
+      data.max_path = std::max(data.max_path, value);
     }
 
     // 平均値などを計算
-    auto play_times = getRecord<uint32_t>("play-times");
-    {
-      auto average = getRecord<double>("average-score");
-      average = (average * (play_times - 1) + score.total_score) / play_times;
-      setRecord("average-score", average);
-    }
-    {
-      auto average = getRecord<double>("average-put-panels");
-      average = (average * (play_times - 1) + score.total_panels) / play_times;
-      setRecord("average-put-panels", average);
-    }
+    auto play_times = data.play_times;
+    auto average = [play_times](double& average, double value) noexcept
+                   {
+                     average = (average * (play_times - 1) + value) / play_times;
+                   };
+    average(data.average_score,       score.total_score);
+    average(data.average_put_panels,  score.total_panels);
+    average(data.average_moved_times, score.panel_moved_times);
+    average(data.average_turn_times,  score.panel_turned_times);
     {
-      auto average = getRecord<double>("average-moved-times");
-      average = (average * (play_times - 1) + score.panel_moved_times) / play_times;
-      setRecord("average-moved-times", average);
-    }
-    {
-      auto average = getRecord<double>("average-turn-times");
-      average = (average * (play_times - 1) + score.panel_turned_times) / play_times;
-      setRecord("average-turn-times", average);
-    }
-    {
-      auto average = getRecord<double>("average-put-time");
-
       // NOTICE １つも置けなかった場合は１つ置いた時と同じ扱い
       auto panels = std::max(score.total_panels, u_int(1));
-      auto put_time = score.limit_time / double(panels);
-      average = (average * (play_times - 1) + put_time) / play_times;
-      setRecord("average-put-time", average);
+      average(data.average_put_time, score.limit_time / double(panels));
     }
 
     // 記録→保存
     this->save();
   }
 
-  
-  // 記録を取得
-  template <typename T>
-  T getRecord(const std::string& id) const noexcept
-  {
-    return records_.getValueForKey<T>(id);
-  }
 
-  // 記録を変更
-  template <typename T>
-  void setRecord(const std::string& id, const T& value) noexcept
+  // 保存要求
+  // NOTICE 実際の書き出しはupdate()かflush()で行う
+  void save() noexcept
   {
-    auto json = ci::JsonTree(id, value);
-    if (records_.hasChild(id))
-    {
-      records_[id] = json;
-    }
-    else
-    {
-      records_.addChild(json);
-      DOUT << "new record value: " << id << std::endl;
-    }
+    dirty_ = true;
   }
 
-  // 値に加算する
-  template <typename T>
-  void addRecord(const std::string& id, T value) noexcept
-  {
-    auto v = getRecord<T>(id);
-    setRecord(id, T(v + value));
-  }
-
-  void setRecordArray(const std::string&id, const ci::JsonTree& json) noexcept
-  {
-    records_[id] = json;
-  }
-
-  const ci::JsonTree& getRecordArray(const std::string& id) const noexcept
-  {
-    return records_[id];
-  }
-
-  bool hasValue(const std::string& id) const
-  {
-    return records_.hasChild(id);
-  }
-
-  // 初期値付き値読み取りだし
-  template <typename T>
-  T getValue(const std::string& id, const T& default_value) const noexcept
-  {
-    return (records_.hasChild(id)) ? records_.getValueForKey<T>(id)
-                                   : default_value;
-  }
-
-
-  void save()
+  // 毎フレーム呼ぶ
+  //   そのフレームでの変更をまとめて書き出す
+  void update() noexcept
   {
+    if (!dirty_) return;
+    dirty_ = false;
+
+    // TIPS 固定長なので複製するだけ。圧縮と書き出しは別スレッド
+    auto data = data_.serialize();
+    writer_.write(full_path_.string(),
+                  [data = std::move(data)]() noexcept
+                  {
 #if defined(OBFUSCATION_ARCHIVE)
-    TextCodec::write(full_path_.string(), records_.serialize());
+                    return TextCodec::encode(data, Codec::Usage::ARCHIVE);
 #else
-    records_.write(full_path_);
+                    return data;
+#endif
+                  });
+#if !defined(OBFUSCATION_ARCHIVE)
+    {
+      // 確認用にJSONでも書き出す
+      auto json_path = full_path_;
+      json_path.replace_extension("json");
+      auto text = data_.toJson().serialize();
+      writer_.write(json_path.string(),
+                    [text = std::move(text)]() noexcept
+                    {
+                      return text;
+                    });
+    }
 #endif
     DOUT << "Archive:write: " << full_path_ << std::endl;
   }
 
+  // 変更を書き出し、書き終わるまで待つ
+  // TIPS 非アクティブになる時に呼ぶ
+  void flush() noexcept
+  {
+    update();
+    writer_.flush();
+  }
+
   // 消去
   void erase() noexcept
   {
     // 一部の情報は引き継ぐ
-    auto purchased = Json::getValue(records_, "PM-PERCHASE01", false);
-    auto tutorial  = Json::getValue(records_, "tutorial", true);
+    auto purchased = data_.purchased;
+    auto tutorial  = data_.tutorial;
 
     // 保存データの消去
-    records_.clear();
+    data_ = ArchiveData(version_);
 
-    this->create();
+    data_.purchased = purchased;
+    data_.tutorial  = tutorial;
+    save();
 
-    this->setRecord("PM-PERCHASE01", purchased);
-    this->setRecord("tutorial", tutorial);
+    history_.erase();
   }
 
 
   // FIXME 特殊化処理を抽象的にするには？
   static bool isPurchased(const Archive& archive)
   {
-    auto value = Json::getValue(archive.records_, "PM-PERCHASE01", false);
+    auto value = archive.data_.purchased;
     DOUT << "Purchased: " << value << std::endl;
 
     return value;
@@ -297,7 +332,7 @@ public:
 
   static bool isTutorial(const Archive& archive)
   {
-    auto value = Json::getValue(archive.records_, "tutorial", true);
+    auto value = archive.data_.tutorial;
     DOUT << "Tutorial: " << value << std::endl;
     return value;
   }
@@ -308,7 +343,14 @@ private:
 
   ci::fs::path full_path_;
 
-  ci::JsonTree records_;
+  ArchiveData data_;
+
+  // 書き出していない変更がある
+  bool dirty_ = false;
+  // NOTICE history_が使うので先に生成する
+  AsyncFileWriter writer_;
+
+  GameHistory history_;
 };
 
 }
@@ -0,0 +1,257 @@
+﻿#pragma once
+
+//
+// ゲーム内記録の中身
+//   固定長の構造体をそのままバイナリで保存する
+//   JSONは以前の形式からの移行と書き出し(デバッグ用)にだけ使う
+//
+//   Header
+//   ArchiveData × 1(Header::sizeバイト)
+//
+// NOTICE 項目は末尾にだけ追加し、VERSIONを上げること
+//        古い形式を読むと追加した項目は初期値になる
+//
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+#include <cinder/Json.h>
+#include "JsonUtil.hpp"
+
+
+namespace ngs {
+
+struct ArchiveData
+{
+  enum
+  {
+    VERSION     = 1,
+    RANKING_MAX = 16,
+    PATH_SIZE   = 48,
+  };
+
+  // ランキング
+  struct Game
+  {
+    uint32_t score;
+    uint32_t rank;
+    // 保存したゲーム記録(空:初期値の記録)
+    char path[PATH_SIZE];
+  };
+
+  // 累積記録
+  uint32_t play_times         = 0;
+  uint32_t high_score         = 500;
+  uint32_t total_panels       = 0;
+  uint32_t panel_turned_times = 0;
+  uint32_t panel_moved_times  = 0;
+  uint32_t share_times        = 0;
+  uint32_t startup_times      = 0;
+  uint32_t abort_times        = 0;
+
+  uint32_t max_panels = 0;
+  uint32_t max_forest = 0;
+  uint32_t max_path   = 0;
+
+  double average_score       = 0.0;
+  double average_put_panels  = 0.0;
+  double average_moved_times = 0.0;
+  double average_turn_times  = 0.0;
+  double average_put_time    = 0.0;
+
+  bool bgm_enable = true;
+  bool se_enable  = true;
+  // 途中のゲームが保存されている
+  bool saved      = false;
+  // PM-PERCHASE01
+  bool purchased  = false;
+  bool tutorial   = true;
+
+  // スコアの高い順
+  uint32_t game_num = 0;
+  Game games[RANKING_MAX] = { };
+
+  char version[16] = { };
+
+
+  // FIXME 初期ランクがハードコーディング
+  ArchiveData(const std::string& app_version = std::string()) noexcept
+  {
+    game_num = 10;
+    for (uint32_t i = 0; i < game_num; ++i)
+    {
+      games[i].score = high_score;
+    }
+    setString(version, app_version);
+  }
+
+
+  template <size_t N>
+  static void setString(char (&dst)[N], const std::string& src) noexcept
+  {
+    auto n = std::min(src.size(), N - 1);
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+  }
+
+
+  struct Header
+  {
+    char     magic[4];
+    uint32_t version;
+    uint32_t size;
+  };
+
+  static const char* magic() noexcept
+  {
+    return "PMAR";
+  }
+
+  // バイナリ形式か調べる
+  static bool isBinary(const std::string& data) noexcept
+  {
+    return data.size() >= sizeof(Header) && !std::memcmp(data.data(), magic(), sizeof(Header::magic));
+  }
+
+  std::string serialize() const noexcept
+  {
+    Header header;
+    std::memcpy(header.magic, magic(), sizeof(header.magic));
+    header.version = VERSION;
+    header.size    = sizeof(ArchiveData);
+
+    std::string data(sizeof(Header) + sizeof(ArchiveData), '\0');
+    std::memcpy(&data[0], &header, sizeof(header));
+    std::memcpy(&data[sizeof(Header)], this, sizeof(ArchiveData));
+    return data;
+  }
+
+  // 戻り値:false 形式が違うか、新しいバージョンの記録
+  bool deserialize(const std::string& data) noexcept
+  {
+    if (!isBinary(data)) return false;
+
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version > VERSION || data.size() < sizeof(Header) + header.size) return false;
+
+    // TIPS 古い形式は足りない項目が初期値のまま残る
+    std::memcpy(this, &data[sizeof(Header)], std::min(size_t(header.size), sizeof(ArchiveData)));
+    game_num = std::min(game_num, uint32_t(RANKING_MAX));
+    for (auto& g : games)
+    {
+      g.path[PATH_SIZE - 1] = '\0';
+    }
+    version[sizeof(version) - 1] = '\0';
+    // NOTICE 0と1以外の値のboolは未定義動作なので、bool以外で読んで直す
+    for (auto* b : { &bgm_enable, &se_enable, &saved, &purchased, &tutorial })
+    {
+      unsigned char value;
+      std::memcpy(&value, b, sizeof(value));
+      *b = value != 0;
+    }
+
+    return true;
+  }
+
+
+  // 以前のJSON形式から読み込む
+  void fromJson(const ci::JsonTree& json) noexcept
+  {
+    play_times         = Json::getValue(json, "play-times",         play_times);
+    high_score         = Json::getValue(json, "high-score",         high_score);
+    total_panels       = Json::getValue(json, "total-panels",       total_panels);
+    panel_turned_times = Json::getValue(json, "panel-turned-times", panel_turned_times);
+    panel_moved_times  = Json::getValue(json, "panel-moved-times",  panel_moved_times);
+    share_times        = Json::getValue(json, "share-times",        share_times);
+    startup_times      = Json::getValue(json, "startup-times",      startup_times);
+    abort_times        = Json::getValue(json, "abort-times",        abort_times);
+
+    max_panels = Json::getValue(json, "max-panels", max_panels);
+    max_forest = Json::getValue(json, "max-forest", max_forest);
+    max_path   = Json::getValue(json, "max-path",   max_path);
+
+    average_score       = Json::getValue(json, "average-score",       average_score);
+    average_put_panels  = Json::getValue(json, "average-put-panels",  average_put_panels);
+    average_moved_times = Json::getValue(json, "average-moved-times", average_moved_times);
+    average_turn_times  = Json::getValue(json, "average-turn-times",  average_turn_times);
+    average_put_time    = Json::getValue(json, "average-put-time",    average_put_time);
+
+    bgm_enable = Json::getValue(json, "bgm-enable",    bgm_enable);
+    se_enable  = Json::getValue(json, "se-enable",     se_enable);
+    saved      = Json::getValue(json, "saved",         saved);
+    purchased  = Json::getValue(json, "PM-PERCHASE01", purchased);
+    tutorial   = Json::getValue(json, "tutorial",      tutorial);
+
+    if (json.hasChild("games"))
+    {
+      const auto& g = json["games"];
+      game_num = uint32_t(std::min(g.getNumChildren(), size_t(RANKING_MAX)));
+      for (uint32_t i = 0; i < game_num; ++i)
+      {
+        games[i].score = Json::getValue(g[i], "score", 0u);
+        games[i].rank  = Json::getValue(g[i], "rank",  0u);
+        setString(games[i].path, Json::getValue(g[i], "path", std::string()));
+      }
+    }
+
+    if (json.hasChild("version"))
+    {
+      setString(version, json.getValueForKey<std::string>("version"));
+    }
+  }
+
+  // 確認用
+  ci::JsonTree toJson() const noexcept
+  {
+    auto g = ci::JsonTree::makeArray("games");
+    for (uint32_t i = 0; i < game_num; ++i)
+    {
+      auto game = ci::JsonTree::makeObject();
+      game.addChild(ci::JsonTree("score", games[i].score))
+          .addChild(ci::JsonTree("rank",  games[i].rank));
+      if (games[i].path[0])
+      {
+        game.addChild(ci::JsonTree("path", std::string(games[i].path)));
+      }
+      g.pushBack(game);
+    }
+
+    auto json = ci::JsonTree::makeObject();
+    json.addChild(ci::JsonTree("play-times",         play_times))
+        .addChild(ci::JsonTree("high-score",         high_score))
+        .addChild(ci::JsonTree("total-panels",       total_panels))
+        .addChild(ci::JsonTree("panel-turned-times", panel_turned_times))
+        .addChild(ci::JsonTree("panel-moved-times",  panel_moved_times))
+        .addChild(ci::JsonTree("share-times",        share_times))
+        .addChild(ci::JsonTree("startup-times",      startup_times))
+        .addChild(ci::JsonTree("abort-times",        abort_times))
+
+        .addChild(ci::JsonTree("max-panels", max_panels))
+        .addChild(ci::JsonTree("max-forest", max_forest))
+        .addChild(ci::JsonTree("max-path",   max_path))
+
+        .addChild(ci::JsonTree("average-score",       average_score))
+        .addChild(ci::JsonTree("average-put-panels",  average_put_panels))
+        .addChild(ci::JsonTree("average-moved-times", average_moved_times))
+        .addChild(ci::JsonTree("average-turn-times",  average_turn_times))
+        .addChild(ci::JsonTree("average-put-time",    average_put_time))
+
+        .addChild(ci::JsonTree("bgm-enable",    bgm_enable))
+        .addChild(ci::JsonTree("se-enable",     se_enable))
+        .addChild(ci::JsonTree("saved",         saved))
+        .addChild(ci::JsonTree("PM-PERCHASE01", purchased))
+        .addChild(ci::JsonTree("tutorial",      tutorial))
+
+        .addChild(g)
+        .addChild(ci::JsonTree("version", std::string(version)))
+    ;
+    return json;
+  }
+};
+
+static_assert(std::is_trivially_copyable<ArchiveData>::value, "ArchiveData");
+
+}
@@ -3,23 +3,77 @@
 //
 // アセット読み込み
 //  OSX版のみDEBUGビルドで特殊なパスから読み込むようにしている
+//  パックファイル(tools/main.cpp で作る)があればそこから、
+//  無いかパックに含まれていなければ個別のファイルを読む
+//  DEBUGでは編集したファイルがすぐ反映されるよう、パックは使わない
 //
 
 #include "Path.hpp"
+#include "AssetPack.hpp"
 
 
 namespace ngs { namespace Asset {
 
 ci::DataSourceRef load(const std::string& path);
+bool find(const std::string& path, const void*& data, size_t& size) noexcept;
 
 
 #if defined (NGS_ASSET_IMPLEMENTATION)
 
+namespace {
+
+// TIPS 最初に使った時に開き、終了まで開きっぱなし
+const AssetPack& getPack() noexcept
+{
+#if defined (DEBUG)
+  static AssetPack pack("");
+#else
+  static AssetPack pack(getAssetPath("assets.pack").string());
+#endif
+  return pack;
+}
+
+}
+
 ci::DataSourceRef load(const std::string& path)
 {
+  const auto& pack = getPack();
+  if (const auto* entry = pack.find(path))
+  {
+    if (entry->method == PackFormat::STORE)
+    {
+#if defined (DEBUG)
+      if (!pack.verify(*entry)) DOUT << "Pack CRC error: " << path << std::endl;
+#endif
+      // NOTICE 複製せずにマップした領域をそのまま使う(Bufferは所有しない)
+      auto buffer = ci::Buffer::create(const_cast<char*>(pack.data(*entry)), size_t(entry->size));
+      return ci::DataSourceBuffer::create(buffer, path);
+    }
+
+    auto buffer = ci::Buffer::create(size_t(entry->original_size));
+    if (pack.extract(*entry, buffer->getData()))
+    {
+      return ci::DataSourceBuffer::create(buffer, path);
+    }
+    DOUT << "Pack extract error: " << path << std::endl;
+  }
+
   return ci::loadFile(getAssetPath(path));
 }
 
+// パックに無圧縮で含まれているデータを直接参照する
+// 戻り値:false パックが無いか含まれていない(圧縮されている)
+bool find(const std::string& path, const void*& data, size_t& size) noexcept
+{
+  const auto& pack = getPack();
+  const auto* entry = pack.find(path);
+  if (!entry || entry->method != PackFormat::STORE) return false;
+
+  data = pack.data(*entry);
+  size = size_t(entry->size);
+  return true;
+}
+
 #endif
 
 } }
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+//
+// tools/main.cpp で作ったアセットのパックファイルを読む(PackFormat.hpp)
+//   ファイル全体をメモリマップし、名前順の索引から探す
+//   無圧縮のデータは複製せず、マップした領域をそのまま返す
+//
+
+#include <string>
+#include <zlib.h>
+#include <boost/noncopyable.hpp>
+#include "MappedFile.hpp"
+#include "PackFormat.hpp"
+
+
+namespace ngs {
+
+class AssetPack
+  : private boost::noncopyable
+{
+  MappedFile file_;
+  const PackFormat::Header* header_ = nullptr;
+
+
+public:
+  using Entry = PackFormat::Entry;
+
+  // 開けなかったか形式が違う場合は空のパックになる
+  explicit AssetPack(const std::string& path) noexcept
+    : file_(path)
+  {
+    if (!file_.isOpen()) return;
+
+    header_ = PackFormat::getHeader(file_.data(), file_.size());
+  }
+
+
+  bool empty() const noexcept
+  {
+    return !header_ || !header_->entry_num;
+  }
+
+  size_t size() const noexcept
+  {
+    return header_ ? size_t(header_->entry_num) : 0;
+  }
+
+  // 戻り値:nullptr 含まれていない
+  const Entry* find(const std::string& name) const noexcept
+  {
+    if (!header_) return nullptr;
+    return PackFormat::find(*header_, name.data(), name.size());
+  }
+
+  // 格納されているデータ(entry.size)
+  const char* data(const Entry& entry) const noexcept
+  {
+    return static_cast<const char*>(file_.data()) + entry.offset;
+  }
+
+  // 格納されているデータのCRC32を調べる
+  bool verify(const Entry& entry) const noexcept
+  {
+    // NOTICE zlibのcrc32はuIntずつしか扱えない
+    uLong crc = crc32(0, Z_NULL, 0);
+    const auto* p = reinterpret_cast<const Bytef*>(data(entry));
+    auto size = entry.size;
+    while (size > 0)
+    {
+      auto n = uInt(std::min<uint64_t>(size, 0x40000000));
+      crc = crc32(crc, p, n);
+      p    += n;
+      size -= n;
+    }
+    return uint32_t(crc) == entry.crc32;
+  }
+
+  // 展開する
+  //   output: entry.original_size の領域を用意しておく
+  // 戻り値:false データが壊れている
+  bool extract(const Entry& entry, void* output) const noexcept
+  {
+    switch (entry.method)
+    {
+    case PackFormat::STORE:
+      std::memcpy(output, data(entry), size_t(entry.size));
+      return entry.size == entry.original_size;
+
+    case PackFormat::ZLIB:
+      {
+        if (!verify(entry)) return false;
+
+        uLongf size = uLongf(entry.original_size);
+        auto result = uncompress(static_cast<Bytef*>(output), &size,
+                                 reinterpret_cast<const Bytef*>(data(entry)), uLong(entry.size));
+        return result == Z_OK && size == entry.original_size;
+      }
+
+    default:
+      return false;
+    }
+  }
+};
+
+}
@@ -0,0 +1,185 @@
+﻿#pragma once
+
+//
+// ファイルの非同期書き出し
+//   専用スレッドで一時ファイルへ書き出し、書き終えてから置き換える
+//   (途中で終了されても壊れたファイルが残らない)
+//   同じファイルへの書き出しが溜まっている時は最新のものだけ書く
+//   追記のような順番が大事な処理はrun()で要求順に実行する
+//
+
+#include "Defines.hpp"
+#include <string>
+#include <map>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdio>
+#include <boost/noncopyable.hpp>
+
+#if defined (_MSC_VER)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace ngs {
+
+class AsyncFileWriter
+  : private boost::noncopyable
+{
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // 書き出しが終わった
+  std::condition_variable done_cv_;
+  bool running_ = true;
+  bool busy_    = false;
+
+  // パス→書き出す内容を作る関数
+  std::map<std::string, std::function<std::string()>> requests_;
+  // 要求順に実行する処理
+  std::vector<std::function<void()>> tasks_;
+
+  std::thread thread_;
+
+
+  // 書き出してからディスクへの反映を待つ
+  static bool writeFile(const std::string& path, const std::string& data) noexcept
+  {
+    auto* fp = std::fopen(path.c_str(), "wb");
+    if (!fp) return false;
+
+    bool result = std::fwrite(data.data(), 1, data.size(), fp) == data.size()
+                  && sync(fp);
+    return (std::fclose(fp) == 0) && result;
+  }
+
+  static void writeAtomic(const std::string& path, const std::string& data) noexcept
+  {
+    auto temp_path = path + ".tmp";
+    if (!writeFile(temp_path, data))
+    {
+      DOUT << "AsyncFileWriter: write error: " << temp_path << std::endl;
+      return;
+    }
+
+    // TIPS 同じボリューム内なら置き換えは不可分
+#if defined (_MSC_VER)
+    bool result = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool result = std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+    if (!result)
+    {
+      DOUT << "AsyncFileWriter: rename error: " << path << std::endl;
+    }
+  }
+
+  void threadMain() noexcept
+  {
+    while (true)
+    {
+      std::map<std::string, std::function<std::string()>> requests;
+      std::vector<std::function<void()>> tasks;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        busy_ = false;
+        done_cv_.notify_all();
+        cv_.wait(lock, [this]()
+                       {
+                         return !running_ || !requests_.empty() || !tasks_.empty();
+                       });
+        // NOTICE 終了時も溜まっているものは書き出す
+        if (!running_ && requests_.empty() && tasks_.empty()) return;
+
+        requests.swap(requests_);
+        tasks.swap(tasks_);
+        busy_ = true;
+      }
+
+      // NOTICE 追記を先に済ませる
+      //        (GameHistoryの識別子を含む記録が先に書かれると、途中で終了した時に辿れなくなる)
+      for (const auto& task : tasks)
+      {
+        task();
+      }
+      for (const auto& it : requests)
+      {
+        // TIPS 空は内容を作るのに失敗したので、以前のファイルを残す
+        auto data = it.second();
+        if (data.empty())
+        {
+          DOUT << "AsyncFileWriter: no data: " << it.first << std::endl;
+          continue;
+        }
+        writeAtomic(it.first, data);
+      }
+    }
+  }
+
+
+public:
+  // 書き出した内容がディスクへ反映されるのを待つ
+  static bool sync(std::FILE* fp) noexcept
+  {
+    if (std::fflush(fp) != 0) return false;
+#if defined (_MSC_VER)
+    return _commit(_fileno(fp)) == 0;
+#else
+    return ::fsync(::fileno(fp)) == 0;
+#endif
+  }
+
+
+  AsyncFileWriter() noexcept
+    : thread_(&AsyncFileWriter::threadMain, this)
+  {}
+
+  ~AsyncFileWriter()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+
+  // 書き出し要求
+  //   make: 書き出す内容を作る(書き出し用のスレッドで呼ばれる)
+  void write(const std::string& path, std::function<std::string()> make) noexcept
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requests_[path] = std::move(make);
+    }
+    cv_.notify_one();
+  }
+
+  // 書き出し用のスレッドで実行
+  //   要求した順に実行される
+  void run(std::function<void()> task) noexcept
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  // 全て書き終わるまで待つ
+  void flush() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]()
+                        {
+                          return requests_.empty() && tasks_.empty() && !busy_;
+                        });
+  }
+};
+
+}
@@ -0,0 +1,220 @@
+﻿#pragma once
+
+//
+// 性能計測用のフレームループ
+//   固定の経過時間と記録された入力で毎回同じ内容を再現し、
+//   update/drawのCPU時間をパーセンタイルで報告する
+//   閾値を超えたら終了コードが1になる
+//   NOTICE アプリ本体をそのまま動かすので、GLのウィンドウを開ける環境が必要
+//          記録は使い捨ての場所に書き出す
+//
+//   起動引数: --benchmark script.json
+//   {
+//     "frames":     1200,
+//     "delta_time": 0.016666,
+//     "seed":       1,
+//     "threshold":  { "update_p99": 4.0, "draw_p99": 8.0 },
+//     "input": [
+//       { "frame": 240, "type": "began", "pos": [ 480, 320 ] },
+//       { "frame": 245, "type": "ended", "pos": [ 480, 320 ] }
+//     ]
+//   }
+//
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+#include <boost/noncopyable.hpp>
+#include "Event.hpp"
+#include "Arguments.hpp"
+#include "Touch.hpp"
+#include "JsonUtil.hpp"
+
+
+namespace ngs {
+
+class Benchmark
+  : private boost::noncopyable
+{
+  using Clock = std::chrono::steady_clock;
+
+  struct Input
+  {
+    u_int frame;
+    std::string type;
+    glm::vec2 pos;
+  };
+
+  struct Result
+  {
+    double p50;
+    double p90;
+    double p99;
+    double max;
+  };
+
+
+public:
+  Benchmark(const ci::JsonTree& script, Event<Arguments>& event) noexcept
+    : event_(event),
+      frames_(script.getValueForKey<u_int>("frames")),
+      delta_time_(Json::getValue(script, "delta_time", 1.0 / 60.0)),
+      update_threshold_(Json::getValue(script, "threshold.update_p99", 0.0)),
+      draw_threshold_(Json::getValue(script, "threshold.draw_p99", 0.0))
+  {
+    if (script.hasChild("input"))
+    {
+      for (const auto& p : script["input"])
+      {
+        inputs_.push_back({ p.getValueForKey<u_int>("frame"),
+                            p.getValueForKey<std::string>("type"),
+                            Json::getVec<glm::vec2>(p["pos"]) });
+      }
+      std::stable_sort(std::begin(inputs_), std::end(inputs_),
+                       [](const Input& a, const Input& b)
+                       {
+                         return a.frame < b.frame;
+                       });
+    }
+
+    update_time_.reserve(frames_);
+    draw_time_.reserve(frames_);
+
+    DOUT << "Benchmark: " << frames_ << " frames" << std::endl;
+  }
+
+  ~Benchmark() = default;
+
+
+  double currentTime() const noexcept
+  {
+    return frame_ * delta_time_;
+  }
+
+  double deltaTime() const noexcept
+  {
+    return delta_time_;
+  }
+
+
+  // このフレームの入力を送信してから計測開始
+  void beginUpdate() noexcept
+  {
+    signalInputs();
+    begin_ = Clock::now();
+  }
+
+  void endUpdate() noexcept
+  {
+    update_time_.push_back(elapsed());
+  }
+
+  void beginDraw() noexcept
+  {
+    begin_ = Clock::now();
+  }
+
+  void endDraw() noexcept
+  {
+    draw_time_.push_back(elapsed());
+  }
+
+  // 戻り値:true 計測終了
+  // TIPS 終了するまでフレームは進むが、trueを返すのは一度だけ
+  bool nextFrame() noexcept
+  {
+    ++frame_;
+    return frame_ == frames_;
+  }
+
+  // 結果を出力
+  // 戻り値:false 閾値を超えた
+  bool report(std::ostream& os) const noexcept
+  {
+    auto update = calcResult(update_time_);
+    auto draw   = calcResult(draw_time_);
+
+    os << "phase,p50_ms,p90_ms,p99_ms,max_ms\n";
+    os << "update," << update.p50 << ',' << update.p90 << ',' << update.p99 << ',' << update.max << '\n';
+    os << "draw,"   << draw.p50   << ',' << draw.p90   << ',' << draw.p99   << ',' << draw.max   << '\n';
+
+    bool passed = true;
+    if (update_threshold_ > 0.0 && update.p99 > update_threshold_)
+    {
+      os << "FAILED: update p99 " << update.p99 << "ms > " << update_threshold_ << "ms\n";
+      passed = false;
+    }
+    if (draw_threshold_ > 0.0 && draw.p99 > draw_threshold_)
+    {
+      os << "FAILED: draw p99 " << draw.p99 << "ms > " << draw_threshold_ << "ms\n";
+      passed = false;
+    }
+    return passed;
+  }
+
+
+private:
+  double elapsed() const noexcept
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin_).count();
+  }
+
+  static Result calcResult(std::vector<double> times) noexcept
+  {
+    if (times.empty()) return { };
+
+    std::sort(std::begin(times), std::end(times));
+    auto at = [&times](double rate)
+              {
+                auto index = size_t(rate * (times.size() - 1) + 0.5);
+                return times[index];
+              };
+
+    return { at(0.5), at(0.9), at(0.99), times.back() };
+  }
+
+  // TouchEventのマウス操作と同じイベントを送る
+  void signalInputs() noexcept
+  {
+    while (input_index_ < inputs_.size() && inputs_[input_index_].frame <= frame_)
+    {
+      const auto& input = inputs_[input_index_];
+      ++input_index_;
+
+      Touch touch{
+        1,
+        false,
+        input.pos,
+        prev_pos_
+      };
+      Arguments arg{
+        { "touch", touch }
+      };
+      event_.signal("single_touch_" + input.type, arg);
+
+      prev_pos_ = input.pos;
+    }
+  }
+
+
+  Event<Arguments>& event_;
+
+  u_int frames_;
+  u_int frame_ = 0;
+  double delta_time_;
+
+  double update_threshold_;
+  double draw_threshold_;
+
+  std::vector<Input> inputs_;
+  size_t input_index_ = 0;
+  glm::vec2 prev_pos_;
+
+  Clock::time_point begin_;
+  std::vector<double> update_time_;
+  std::vector<double> draw_time_;
+};
+
+}
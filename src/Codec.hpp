@@ -0,0 +1,245 @@
+﻿#pragma once
+
+//
+// 圧縮方法の切り替え
+//   先頭に圧縮方法と展開後のサイズを書いておく
+//   LZ4とzstdはライブラリを用意してNGS_USE_LZ4/NGS_USE_ZSTDを定義した時だけ使える
+//   NOTICE tools/codec からも使うのでCinderに依存しないこと
+//
+//   char     magic[3]
+//   char     type
+//   uint32_t 展開後のサイズ
+//   圧縮したデータ
+//
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <zlib.h>
+
+#if defined (NGS_USE_LZ4)
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#if defined (NGS_USE_ZSTD)
+#include <zstd.h>
+#endif
+
+
+namespace ngs { namespace Codec {
+
+// TIPS TextCodecの "NGSZ" がそのままzlibになるようにしている
+enum Type : char
+{
+  STORE = 'S',
+  ZLIB  = 'Z',
+  LZ4   = '4',
+  ZSTD  = 'D',
+};
+
+struct Method
+{
+  Type type;
+  int level;
+};
+
+// データの種類
+enum class Usage
+{
+  // 起動時に読むので展開の速さ優先
+  PARAMS,
+  // ゲーム終了時に書くので圧縮の速さ優先
+  ARCHIVE,
+  GAME_RECORD,
+};
+
+constexpr char MAGIC[3] = { 'N', 'G', 'S' };
+
+struct Header
+{
+  char     magic[3];
+  char     type;
+  uint32_t size;
+};
+
+static_assert(sizeof(Header) == 8, "Codec::Header");
+
+// 展開後のサイズの上限
+// TIPS 壊れたヘッダの値でそのまま確保しないよう、どのデータよりも十分大きな値で制限する
+constexpr size_t MAX_SIZE = 64 * 1024 * 1024;
+
+
+inline bool isAvailable(Type type) noexcept
+{
+  switch (type)
+  {
+  case STORE:
+  case ZLIB:
+    return true;
+
+#if defined (NGS_USE_LZ4)
+  case LZ4:
+    return true;
+#endif
+
+#if defined (NGS_USE_ZSTD)
+  case ZSTD:
+    return true;
+#endif
+
+  default:
+    return false;
+  }
+}
+
+// 種類ごとの圧縮方法
+inline Method getMethod(Usage usage) noexcept
+{
+  switch (usage)
+  {
+  case Usage::PARAMS:
+    // TIPS JSONではzstdよりLZ4(HC)の方が展開がずっと速い
+#if defined (NGS_USE_LZ4)
+    return { LZ4, 12 };
+#elif defined (NGS_USE_ZSTD)
+    return { ZSTD, 19 };
+#else
+    // TIPS zlibは圧縮率を上げても展開の速さは変わらない
+    return { ZLIB, Z_BEST_COMPRESSION };
+#endif
+
+  case Usage::ARCHIVE:
+  case Usage::GAME_RECORD:
+  default:
+#if defined (NGS_USE_LZ4)
+    return { LZ4, 0 };
+#elif defined (NGS_USE_ZSTD)
+    return { ZSTD, 1 };
+#else
+    return { ZLIB, Z_BEST_SPEED };
+#endif
+  }
+}
+
+
+// 戻り値:nullptr 以前の形式(zlibのストリームのみ)
+inline const Header* getHeader(const void* data, size_t size) noexcept
+{
+  if (size < sizeof(Header)) return nullptr;
+
+  const auto* header = static_cast<const Header*>(data);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC))) return nullptr;
+
+  return header;
+}
+
+// 圧縮(ヘッダ込み)
+// 戻り値:empty 使えない圧縮方法か、圧縮に失敗した
+inline std::string compress(const void* data, size_t size, const Method& method) noexcept
+{
+  if (!isAvailable(method.type)) return { };
+
+  Header header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.type = method.type;
+  header.size = uint32_t(size);
+
+  std::string output(sizeof(Header), '\0');
+  std::memcpy(&output[0], &header, sizeof(header));
+
+  const auto* src = static_cast<const char*>(data);
+  switch (method.type)
+  {
+  case STORE:
+    output.append(src, size);
+    break;
+
+  case ZLIB:
+    {
+      uLongf n = compressBound(uLong(size));
+      output.resize(sizeof(Header) + n);
+      if (compress2(reinterpret_cast<Bytef*>(&output[sizeof(Header)]), &n,
+                    reinterpret_cast<const Bytef*>(src), uLong(size), method.level) != Z_OK)
+      {
+        return { };
+      }
+      output.resize(sizeof(Header) + n);
+    }
+    break;
+
+#if defined (NGS_USE_LZ4)
+  case LZ4:
+    {
+      int bound = LZ4_compressBound(int(size));
+      output.resize(sizeof(Header) + bound);
+      auto* dst = &output[sizeof(Header)];
+      // TIPS levelが0なら高速版
+      int n = method.level ? LZ4_compress_HC(src, dst, int(size), bound, method.level)
+                           : LZ4_compress_default(src, dst, int(size), bound);
+      if (n <= 0) return { };
+      output.resize(sizeof(Header) + n);
+    }
+    break;
+#endif
+
+#if defined (NGS_USE_ZSTD)
+  case ZSTD:
+    {
+      auto bound = ZSTD_compressBound(size);
+      output.resize(sizeof(Header) + bound);
+      auto n = ZSTD_compress(&output[sizeof(Header)], bound, src, size, method.level);
+      if (ZSTD_isError(n)) return { };
+      output.resize(sizeof(Header) + n);
+    }
+    break;
+#endif
+
+  default:
+    return { };
+  }
+
+  return output;
+}
+
+// 展開
+//   output: header.size に合わせて確保される
+// 戻り値:false 壊れているか使えない圧縮方法
+inline bool decompress(const Header& header, size_t size, std::string& output) noexcept
+{
+  const auto* src = reinterpret_cast<const char*>(&header + 1);
+  size -= sizeof(Header);
+  if (header.size > MAX_SIZE) return false;
+
+  output.resize(header.size);
+  switch (header.type)
+  {
+  case STORE:
+    if (size != header.size) return false;
+    std::memcpy(&output[0], src, size);
+    return true;
+
+  case ZLIB:
+    {
+      uLongf n = header.size;
+      return uncompress(reinterpret_cast<Bytef*>(&output[0]), &n,
+                        reinterpret_cast<const Bytef*>(src), uLong(size)) == Z_OK
+             && n == header.size;
+    }
+
+#if defined (NGS_USE_LZ4)
+  case LZ4:
+    return LZ4_decompress_safe(src, &output[0], int(size), int(header.size)) == int(header.size);
+#endif
+
+#if defined (NGS_USE_ZSTD)
+  case ZSTD:
+    return ZSTD_decompress(&output[0], header.size, src, size) == header.size;
+#endif
+
+  default:
+    return false;
+  }
+}
+
+} }
@@ -32,16 +32,30 @@ public:
 
   ~ConnectionHolder()
   {
+    blocks_.clear();
     disconnectAll();
   }
 
 
   void clear() noexcept
   {
+    blocks_.clear();
     disconnectAll();
     connections_.clear();
   }
 
+  // 接続を保ったまま一時的に無効にする
+  void block(bool enable = true) noexcept
+  {
+    blocks_.clear();
+    if (!enable) return;
+
+    for (const auto& c : connections_)
+    {
+      blocks_.emplace_back(c);
+    }
+  }
+
   
   void operator += (Connection& connection) noexcept
   {
@@ -56,6 +70,7 @@ public:
 
 private:
   std::vector<Connection> connections_;
+  std::vector<boost::signals2::shared_connection_block> blocks_;
 };
 
 }
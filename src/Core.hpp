@@ -8,8 +8,10 @@
 
 #include <boost/noncopyable.hpp>
 #include "ConnectionHolder.hpp"
+#include "JsonUtil.hpp"
 #include "UIDrawer.hpp"
 #include "TweenCommon.hpp"
+#include "UICanvasCache.hpp"
 #include "TaskContainer.hpp"
 #include "MainPart.hpp"
 #include "Intro.hpp"
@@ -40,7 +42,7 @@ public:
     : params_(params),
       event_(event),
       achievements_(event),
-      archive_("records.json", params.getValueForKey<std::string>("app.version")),
+      archive_(Json::getValue(params, "app.archive", std::string("records.data")), params.getValueForKey<std::string>("app.version")),
       drawer_(params["ui"]),
       tween_common_(Params::load("tw_common.json"))
   {
@@ -61,7 +63,7 @@ public:
                                 GameMain::Condition condition{
                                   tutorial
                                 };
-                                tasks_.pushBack<GameMain>(params_, event_, drawer_, tween_common_, condition);
+                                tasks_.pushBack<GameMain>(params_, event_, drawer_, tween_common_, canvas_cache_, condition);
                               });
 
     // Tutorial起動
@@ -69,7 +71,7 @@ public:
                               [this](const Connection&, const Arguments&) noexcept
                               {
                                 DOUT << "Tutorial started." << std::endl;
-                                tasks_.pushBack<Tutorial>(params_, event_, drawer_, tween_common_);
+                                tasks_.pushBack<Tutorial>(params_, event_, drawer_, tween_common_, canvas_cache_);
                               });
 
 
@@ -83,7 +85,7 @@ public:
     holder_ += event_.connect("Credits:begin",
                               [this](const Connection&, const Arguments&) noexcept
                               {
-                                tasks_.pushBack<Credits>(params_, event_, drawer_, tween_common_);
+                                tasks_.pushBack<Credits>(params_, event_, drawer_, tween_common_, canvas_cache_);
                               });
     // Credits→Title
     holder_ += event_.connect("Credits:Finished",
@@ -96,13 +98,13 @@ public:
                               [this](const Connection&, const Arguments&) noexcept
                               {
                                 Settings::Condition condition{
-                                  archive_.getRecord<bool>("bgm-enable"),
-                                  archive_.getRecord<bool>("se-enable"),
+                                  archive_.get().bgm_enable,
+                                  archive_.get().se_enable,
                                   archive_.isSaved(),
                                   Archive::isTutorial(archive_)
                                 };
 
-                                tasks_.pushBack<Settings>(params_, event_, drawer_, tween_common_, condition);
+                                tasks_.pushBack<Settings>(params_, event_, drawer_, tween_common_, canvas_cache_, condition);
                               });
 
     // Settings→Title
@@ -110,9 +112,9 @@ public:
                               [this](const Connection&, const Arguments& args) noexcept
                               {
                                 // Settingsの変更内容を記録
-                                archive_.setRecord("bgm-enable", getValue<bool>(args, "bgm-enable"));
-                                archive_.setRecord("se-enable",  getValue<bool>(args, "se-enable"));
-                                archive_.save();
+                                auto& data = archive_.modify();
+                                data.bgm_enable = getValue<bool>(args, "bgm-enable");
+                                data.se_enable  = getValue<bool>(args, "se-enable");
 
                                 startTitle();
                               });
@@ -125,7 +127,7 @@ public:
                                   price_,
                                   Archive::isPurchased(archive_)
                                 };
-                                tasks_.pushBack<Purchase>(params_, event_, drawer_, tween_common_, condition);
+                                tasks_.pushBack<Purchase>(params_, event_, drawer_, tween_common_, canvas_cache_, condition);
                               });
     // Purchase→Title
     holder_ += event_.connect("Purchase:Finished",
@@ -138,27 +140,28 @@ public:
     holder_ += event_.connect("Records:begin",
                               [this](const Connection&, const Arguments&) noexcept
                               {
+                                const auto& data = archive_.get();
                                 Records::Detail detail = {
-                                  archive_.getRecord<u_int>("play-times"),
-                                  archive_.getRecord<u_int>("total-panels"),
-                                  archive_.getRecord<u_int>("panel-turned-times"),
-                                  archive_.getRecord<u_int>("panel-moved-times"),
-                                  archive_.getRecord<u_int>("share-times"),
-                                  archive_.getRecord<u_int>("startup-times"),
-                                  archive_.getRecord<u_int>("abort-times"),
-
-                                  archive_.getRecord<u_int>("max-panels"),
-                                  archive_.getRecord<u_int>("max-forest"),
-                                  archive_.getRecord<u_int>("max-path"),
-
-                                  archive_.getRecord<double>("average-score"),
-                                  archive_.getRecord<double>("average-put-panels"),
-                                  archive_.getRecord<double>("average-moved-times"),
-                                  archive_.getRecord<double>("average-turn-times"),
-                                  archive_.getRecord<double>("average-put-time"),
+                                  data.play_times,
+                                  data.total_panels,
+                                  data.panel_turned_times,
+                                  data.panel_moved_times,
+                                  data.share_times,
+                                  data.startup_times,
+                                  data.abort_times,
+
+                                  data.max_panels,
+                                  data.max_forest,
+                                  data.max_path,
+
+                                  data.average_score,
+                                  data.average_put_panels,
+                                  data.average_moved_times,
+                                  data.average_turn_times,
+                                  data.average_put_time,
                                 };
 
-                                tasks_.pushBack<Records>(params_, event_, drawer_, tween_common_, detail);
+                                tasks_.pushBack<Records>(params_, event_, drawer_, tween_common_, canvas_cache_, detail);
                               });
     // Records→Title
     holder_ += event_.connect("Records:Finished",
@@ -171,13 +174,13 @@ public:
                               [this](const Connection&, const Arguments& args) noexcept
                               {
                                 Arguments ranking_args {
-                                  { "games",      archive_.getRecordArray("games") },
+                                  { "games",      archive_.getGames() },
                                   { "records",    archive_.existsRanking() },
                                   { "record_num", archive_.countRanking() },
                                   { "view",       true }
                                 };
 
-                                tasks_.pushBack<Ranking>(params_, event_, drawer_, tween_common_, ranking_args);
+                                tasks_.pushBack<Ranking>(params_, event_, drawer_, tween_common_, canvas_cache_, ranking_args);
                               });
     // Ranking→Title
     holder_ += event_.connect("Ranking:Finished",
@@ -202,7 +205,7 @@ public:
     holder_ += event_.connect("Result:begin",
                               [this](const Connection&, const Arguments& args) noexcept
                               {
-                                tasks_.pushBack<Result>(params_, event_, drawer_, tween_common_, args);
+                                tasks_.pushBack<Result>(params_, event_, drawer_, tween_common_, canvas_cache_, args);
                               });
     // Result→Title
     holder_ += event_.connect("Result:Finished",
@@ -213,12 +216,12 @@ public:
                                 {
                                   // TOP10に入っていたらRankingを起動
                                   Arguments ranking_args {
-                                    { "games",   archive_.getRecordArray("games") },
+                                    { "games",   archive_.getGames() },
                                     { "rank_in", rank_in },
                                     { "ranking", getValue<u_int>(args, "ranking") },
                                   };
 
-                                  tasks_.pushBack<Ranking>(params_, event_, drawer_, tween_common_, ranking_args);
+                                  tasks_.pushBack<Ranking>(params_, event_, drawer_, tween_common_, canvas_cache_, ranking_args);
                                 }
                                 else
                                 {
@@ -230,8 +233,7 @@ public:
     holder_ += event.connect("Share:completed",
                              [this](const Connection&, const Arguments&) noexcept
                              {
-                               archive_.addRecord("share-times", uint32_t(1));
-                               archive_.save();
+                               archive_.modify().share_times += 1;
                              });
 
     // system
@@ -255,29 +257,37 @@ public:
     holder_ += event.connect("purchase-completed",
                              [this](const Connection&, const Arguments&) noexcept
                              {
-                               archive_.setRecord("PM-PERCHASE01", true);
-                               archive_.save();
+                               archive_.modify().purchased = true;
                                DOUT << "purchase-completed"<< std::endl;
                              });
 
+    // 非アクティブになったら記録の書き出しを待つ
+    // TIPS そのまま終了されても記録が残るように
+    holder_ += event.connect("App:ResignActive",
+                             [this](const Connection&, const Arguments&) noexcept
+                             {
+                               archive_.flush();
+                             });
+
     // アプリの起動回数を更新して保存
-    archive_.addRecord("startup-times", uint32_t(1));
-    archive_.save();
+    archive_.modify().startup_times += 1;
     
     // 最初のタスクを登録
+    // TIPS 更新はTask::Phaseの順(同じPhaseでは登録順)
+    //      Soundは表示のPhaseなので、他の全てのタスクの後で更新される
     tasks_.pushBack<Sound>(params_, event_);
     tasks_.pushBack<MainPart>(params_, event_, archive_);
     {
       Intro::Condition condition{
         Archive::isTutorial(archive_),
       };
-      tasks_.pushBack<Intro>(params_, event_, drawer_, tween_common_, condition);
+      tasks_.pushBack<Intro>(params_, event_, drawer_, tween_common_, canvas_cache_, condition);
     }
 
     {
       // Sound初期設定
-      auto bgm_enable = archive_.getRecord<bool>("bgm-enable");
-      auto se_enable  = archive_.getRecord<bool>("se-enable");
+      auto bgm_enable = archive_.get().bgm_enable;
+      auto se_enable  = archive_.get().se_enable;
       Arguments args{
         { "bgm-enable", bgm_enable },
         { "se-enable",  se_enable }
@@ -291,7 +301,7 @@ public:
                              [this](const Connection&, const Arguments&) noexcept
                              {
                                bool purchased = Archive::isPurchased(archive_);
-                               archive_.setRecord("PM-PERCHASE01", !purchased);
+                               archive_.modify().purchased = !purchased;
                                DOUT << "debug-purchased: " << !purchased << std::endl;
                              });
 
@@ -312,6 +322,8 @@ private:
     auto delta_time   = getValue<double>(args, "delta_time");
 
     tasks_.update(current_time, delta_time);
+    // このフレームでの記録の変更をまとめて書き出す
+    archive_.update();
   }
 
 
@@ -326,7 +338,7 @@ private:
       Archive::isTutorial(archive_)
     };
 
-    tasks_.pushBack<Title>(params_, event_, drawer_, tween_common_, condition);
+    tasks_.pushBack<Title>(params_, event_, drawer_, tween_common_, canvas_cache_, condition);
     // 初回起動の判定
     title_initial_ = false;
   }
@@ -354,6 +366,9 @@ private:
 
   TweenCommon tween_common_;
 
+  // 画面ごとのUIの雛形
+  UI::CanvasCache canvas_cache_;
+
   // Title初回演出
   bool title_initial_ = true;
 };
@@ -2,11 +2,16 @@
 
 //
 // 指定時間経過後に関数実行
-// FIXME 関数ポインタ元のクラスが破棄されると未定義
-// TODO 登録した関数ポインタを無効にする仕組み
+//   締め切り時刻(絶対時間)をキーにした最小ヒープで管理
+//   NOTICE 登録する関数から参照するのは、このインスタンスを持つクラスだけにすること
+//          (メンバとして一緒に破棄されるので、参照先が無くなってから実行されることはない)
 // TODO 登録した関数ポインタを一気に実行する仕組み
 //
 
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <functional>
 #include <boost/noncopyable.hpp>
 
 
@@ -15,28 +20,71 @@ namespace ngs {
 class CountExec
   : private boost::noncopyable
 {
-  struct Callback
-    : private boost::noncopyable
+  // 一時停止の影響を受けるグループと受けないグループ
+  enum Group
   {
-    Callback(double time_remain_, const std::function<void ()>& func_, bool forced)
-      : time_remain(time_remain_),
-        func(func_),
-        force_count(forced)
-    {}
+    NORMAL,
+    FORCED,
 
-    ~Callback() = default;
+    GROUP_NUM
+  };
+
+  // TIPS ヒープの要素を小さくするため、関数は別に持つ
+  struct Entry
+  {
+    double deadline;
+    // 同じ締め切り時刻なら登録順に実行
+    u_int order;
+    u_int index;
+  };
+
+  struct Later
+  {
+    bool operator()(const Entry& a, const Entry& b) const noexcept
+    {
+      if (a.deadline != b.deadline) return a.deadline > b.deadline;
+      return a.order > b.order;
+    }
+  };
 
+  struct Clock
+  {
+    // 現在時刻
+    double current = 0.0;
+    // 登録時の基準時刻
+    // TIPS update中に登録された関数は従来通りそのフレームの経過時間も差し引かれる
+    double origin  = 0.0;
 
-    double time_remain;
-    std::function<void ()> func;
-    bool force_count = false;
+    std::vector<Entry> queue;
   };
 
-  std::list<Callback> callbacks_;
+  std::vector<std::function<void ()>> callbacks_;
+  std::vector<u_int> free_slots_;
+
+  std::array<Clock, GROUP_NUM> clocks_;
+  u_int order_ = 0;
 
   bool pause_ = false;
 
 
+  void execute(Clock& clock) noexcept
+  {
+    // TIPS 実行中にadd/clearされても良いように毎回先頭を確認する
+    while (!clock.queue.empty() && (clock.queue.front().deadline < clock.current))
+    {
+      auto index = clock.queue.front().index;
+      std::pop_heap(std::begin(clock.queue), std::end(clock.queue), Later());
+      clock.queue.pop_back();
+
+      // TIPS 実行前にスロットを解放しておく(実行中のaddでcallbacks_が再確保されても安全)
+      auto func = std::move(callbacks_[index]);
+      callbacks_[index] = nullptr;
+      free_slots_.push_back(index);
+      func();
+    }
+  }
+
+
 public:
   CountExec()  = default;
   ~CountExec() = default;
@@ -44,36 +92,47 @@ public:
 
   void update(double delta_time) noexcept
   {
-    // TIPS for文中でitを更新している
-    for (auto it = std::begin(callbacks_); it != std::end(callbacks_); )
+    for (u_int i = 0; i < GROUP_NUM; ++i)
     {
-      if (pause_ && !it->force_count)
-      {
-        ++it;
-        continue;
-      }
+      auto& clock = clocks_[i];
+      if (pause_ && (i == NORMAL)) continue;
 
-      it->time_remain -= delta_time;
-      if (it->time_remain < 0.0)
-      {
-        it->func();
-        // TIPS eraseは次のイテレーターを返す
-        it = callbacks_.erase(it);
-        continue;
-      }
-      ++it;
+      clock.origin   = clock.current;
+      clock.current += delta_time;
+      execute(clock);
+      clock.origin   = clock.current;
     }
   }
 
 
   void add(double time_remain, const std::function<void ()>& func, bool forced = false) noexcept
   {
-    callbacks_.emplace_back(time_remain, func, forced);
+    u_int index;
+    if (free_slots_.empty())
+    {
+      index = u_int(callbacks_.size());
+      callbacks_.push_back(func);
+    }
+    else
+    {
+      index = free_slots_.back();
+      free_slots_.pop_back();
+      callbacks_[index] = func;
+    }
+
+    auto& clock = clocks_[forced ? FORCED : NORMAL];
+    clock.queue.push_back({ clock.origin + time_remain, order_++, index });
+    std::push_heap(std::begin(clock.queue), std::end(clock.queue), Later());
   }
 
   void clear() noexcept
   {
     callbacks_.clear();
+    free_slots_.clear();
+    for (auto& clock : clocks_)
+    {
+      clock.queue.clear();
+    }
   }
 
   void pause(bool enable = false) noexcept
@@ -84,18 +143,26 @@ public:
   // 最初に実行する関数ポインタまで時間を進める
   void skipToFirst() noexcept
   {
-    if (callbacks_.empty()) return;
+    bool found = false;
+    double t   = 0.0;
+    for (const auto& clock : clocks_)
+    {
+      if (clock.queue.empty()) continue;
 
-    auto it = std::min_element(std::begin(callbacks_), std::end(callbacks_),
-                               [](const auto& a, const auto& b)
-                               {
-                                 return a.time_remain < b.time_remain;
-                               });
+      auto remain = clock.queue.front().deadline - clock.current;
+      if (!found || remain < t)
+      {
+        t     = remain;
+        found = true;
+      }
+    }
+    if (!found) return;
 
-    auto t = it->time_remain;
-    for (auto& cb : callbacks_)
+    // TIPS 一時停止中のグループも含めて進める
+    for (auto& clock : clocks_)
     {
-      cb.time_remain -= t;
+      clock.current += t;
+      clock.origin  += t;
     }
   }
 
@@ -14,12 +14,12 @@ class Credits
   : public Task
 {
 public:
-  Credits(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common) noexcept
+  Credits(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
+          UI::CanvasCache& canvas_cache) noexcept
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("credits.canvas")),
-              Params::load(params.getValueForKey<std::string>("credits.tweens")))
+              canvas_cache.get(params, "credits"))
   {
     startTimelineSound(event_, params, "credits.se");
 
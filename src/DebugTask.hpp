@@ -6,10 +6,15 @@
 
 #if defined (DEBUG) && !defined (CINDER_COCOA_TOUCH)
 
+#include <sstream>
+#include <iomanip>
 #include <cinder/params/Params.h>
 #include "Task.hpp"
 #include "Camera.hpp"
 #include "Model.hpp"
+#include "Profiler.hpp"
+#include "Utility.hpp"
+#include "Path.hpp"
 
 
 // TIPS AntTweakBarを直接使う
@@ -160,6 +165,7 @@ class DebugTask
 
                              auto mesh = PLY::load(p, true);
                              Model::writeTriMesh(p, mesh);
+                             Model::writeBinaryMesh(p, mesh);
                            }
                          });
 
@@ -255,6 +261,55 @@ class DebugTask
   }
 
 
+  // 処理時間をフレーム単位で表示
+  //   横軸は時間、縦軸はスコープの深さ
+  void drawProfiler() noexcept
+  {
+    ci::gl::enableDepth(false);
+    ci::gl::disable(GL_CULL_FACE);
+    ci::gl::enableAlphaBlending();
+
+    ci::gl::ScopedMatrices m;
+    ci::gl::setMatricesWindow(ci::app::getWindowSize());
+
+    // 60fpsの1フレームを画面幅の半分で表示
+    const float frame_msec = 1000.0f / 60.0f;
+    const float bar_height = 14.0f;
+    glm::vec2 origin(10, 30);
+    float scale = ci::app::getWindowWidth() * 0.5f / frame_msec;
+
+    const auto& records = Profiler::lastFrame();
+    for (const auto& r : records)
+    {
+      ci::Rectf rect(origin.x + r.begin * scale,
+                     origin.y + r.depth * bar_height,
+                     origin.x + (r.begin + r.duration) * scale,
+                     origin.y + (r.depth + 1) * bar_height - 1);
+
+      ci::gl::color(ci::ColorA(ci::hsvToRgb({ std::fmod(r.depth * 0.17f, 1.0f), 0.7f, 0.9f }), 0.8f));
+      ci::gl::drawSolidRect(rect);
+
+      // 文字が入る幅の場合だけ名前を表示
+      if (rect.getWidth() > 60.0f)
+      {
+        std::ostringstream str;
+        str << r.name << " " << std::fixed << std::setprecision(2) << r.duration;
+        ci::gl::drawString(str.str(), rect.getUpperLeft() + glm::vec2(2, 1), ci::Color::black());
+      }
+    }
+
+    // 1フレームの目安
+    ci::gl::color(ci::Color(1, 0, 0));
+    ci::gl::drawLine(origin + glm::vec2(frame_msec * scale, -5),
+                     origin + glm::vec2(frame_msec * scale, bar_height * 8));
+
+    std::ostringstream str;
+    str << "frame: " << std::fixed << std::setprecision(2) << Profiler::lastFrameTime() << "ms";
+    if (Profiler::isRecording()) str << " [REC]";
+    ci::gl::drawString(str.str(), glm::vec2(origin.x, 10), ci::Color::white());
+  }
+
+
   void draw(const Connection&, const Arguments&) noexcept
   {
     if (disp_)
@@ -262,6 +317,11 @@ class DebugTask
       previewFont();
     }
 
+    if (Profiler::isEnabled())
+    {
+      drawProfiler();
+    }
+
     drawSettings();
   }
 
@@ -316,6 +376,28 @@ public:
                                 ++disp_index_;
                               });
 
+    holder_ += event_.connect("debug-profiler",
+                              [this](const Connection&, const Arguments&) noexcept
+                              {
+                                Profiler::enable(!Profiler::isEnabled());
+                              });
+
+    // 計測中はフレームごとの記録をCSVへ書き出す
+    holder_ += event_.connect("debug-profiler-csv",
+                              [this](const Connection&, const Arguments&) noexcept
+                              {
+                                if (Profiler::isRecording())
+                                {
+                                  Profiler::stopRecording();
+                                }
+                                else
+                                {
+                                  auto path = getDocumentPath() / ("profile-" + getFormattedDate() + ".csv");
+                                  Profiler::enable();
+                                  Profiler::startRecording(path);
+                                }
+                              });
+
     holder_ += event_.connect("debug-settings",
                               [this](const Connection&, const Arguments&) noexcept
                               {
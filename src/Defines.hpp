@@ -32,13 +32,18 @@
 #define OBFUSCATION_GAME_RECORD
 //不要な記録は削除
 #define REMOVE_UNNECESSARY_RECORD
-// param.jsonの難読化
-#define OBFUSCATION_PARAMS
+// パラメーターは変換済みのもの(params.bundle)を使う
+#define USE_PARAM_BUNDLE
 #endif
 
 // 実績キャッシュの難読化
 // #define OBFUSCATION_ACHIEVEMENT
 
+#if defined (DEBUG)
+// 処理時間計測
+#define NGS_PROFILE
+#endif
+
 #if defined(CINDER_COCOA_TOUCH)
 
 // リリース時 NSLog 一網打尽マクロ
@@ -2,8 +2,13 @@
 
 //
 // 一定時間コールバックを実行する
+//   開始待ちのものは開始時刻をキーにした最小ヒープで管理し、
+//   実行中のものだけを毎フレーム走査する
 //
 
+#include <vector>
+#include <algorithm>
+#include <functional>
 #include <boost/noncopyable.hpp>
 
 
@@ -13,71 +18,90 @@ class FixedTimeExec
   : private boost::noncopyable
 {
   struct Callback
-    : private boost::noncopyable
   {
-    Callback(double delay_time_, double time_remain_, const std::function<bool (double delta_time)>& func_)
-      : delay_time(delay_time_),
+    Callback(u_int order_, double time_remain_, const std::function<bool (double delta_time)>& func_)
+      : order(order_),
         time_remain(time_remain_),
         infinit(time_remain_ < 0.0),
         func(func_)
     {}
 
-    ~Callback() = default;
-
-    double delay_time;
+    // 同じ開始時刻なら登録順に実行
+    u_int order;
     double time_remain;
     bool infinit;
 
     std::function<bool (double)> func;
   };
 
-  std::list<Callback> callbacks_;
+  struct Waiting
+  {
+    double start_time;
+    Callback callback;
+  };
+
+  struct Later
+  {
+    bool operator()(const Waiting& a, const Waiting& b) const noexcept
+    {
+      if (a.start_time != b.start_time) return a.start_time > b.start_time;
+      return a.callback.order > b.callback.order;
+    }
+  };
+
+  std::vector<Waiting> waiting_;
+  std::vector<Callback> running_;
+
+  double current_time_ = 0.0;
+  u_int order_         = 0;
 
 
 public:
   FixedTimeExec()  = default;
   ~FixedTimeExec() = default;
 
-  
+
   void update(double delta_time) noexcept
   {
-    // TIPS for文中でitを更新している
-    for (auto it = std::begin(callbacks_); it != std::end(callbacks_); )
+    // TIPS 実行中にaddされたものはwaiting_へ積まれるので添字で回す
+    for (size_t i = 0; i < running_.size(); ++i)
+    {
+      auto& cb = running_[i];
+      auto result = cb.func(delta_time);
+      if (result && cb.infinit) continue;
+
+      cb.time_remain -= delta_time;
+      cb.infinit      = false;
+    }
+    // 終了したものを取り除く
+    running_.erase(std::remove_if(std::begin(running_), std::end(running_),
+                                  [](const Callback& cb)
+                                  {
+                                    return !cb.infinit && (cb.time_remain < 0.0);
+                                  }),
+                   std::end(running_));
+
+    // 開始時刻を過ぎたものは次のフレームから実行
+    current_time_ += delta_time;
+    while (!waiting_.empty() && (waiting_.front().start_time < current_time_))
     {
-      if (it->delay_time < 0.0)
-      {
-        auto result = it->func(delta_time);
-        if (result && it->infinit)
-        {
-          ++it;
-          continue;
-        }
-
-        it->time_remain -= delta_time;
-        if (it->time_remain < 0.0)
-        {
-          // TIPS eraseは次のイテレーターを返す
-          it = callbacks_.erase(it);
-          continue;
-        }
-      }
-      else
-      {
-        it->delay_time -= delta_time;
-      }
-      ++it;
+      std::pop_heap(std::begin(waiting_), std::end(waiting_), Later());
+      running_.push_back(std::move(waiting_.back().callback));
+      waiting_.pop_back();
     }
   }
 
 
   void add(double delay_time, double time_remain, const std::function<bool (double)>& func) noexcept
   {
-    callbacks_.emplace_back(delay_time, time_remain, func);
+    waiting_.push_back({ current_time_ + delay_time, Callback(order_++, time_remain, func) });
+    std::push_heap(std::begin(waiting_), std::end(waiting_), Later());
   }
 
   void clear() noexcept
   {
-    callbacks_.clear();
+    waiting_.clear();
+    running_.clear();
   }
 };
 
@@ -9,6 +9,8 @@
 #include <cinder/gl/gl.h>
 #include <cinder/gl/Texture.h>
 #include <cinder/TriMesh.h>
+#include "Profiler.hpp"
+#include "Asset.hpp"
 
 #if defined (NGS_FONT_IMPLEMENTATION)
 // #define FONS_VERTEX_COUNT 2048
@@ -207,8 +209,19 @@ Font::Font(const std::string& path,
   assert(context_);
   fonsClearState(context_);
 
-  auto full_path = getAssetPath(path).string();
-  int handle = fonsAddFont(context_, "font", full_path.c_str());
+  // TIPS パックに含まれていればマップした領域をそのまま使う
+  int handle;
+  const void* data;
+  size_t size;
+  if (Asset::find(path, data, size))
+  {
+    handle = fonsAddFontMem(context_, "font", static_cast<unsigned char*>(const_cast<void*>(data)), int(size), 0);
+  }
+  else
+  {
+    auto full_path = getAssetPath(path).string();
+    handle = fonsAddFont(context_, "font", full_path.c_str());
+  }
   fonsSetFont(context_, handle);
 
   // TIPS:下揃えにしておくと、下にはみ出す部分も正しく扱える
@@ -246,6 +259,8 @@ glm::vec2 Font::drawSize(const std::string& text) noexcept
 
 void Font::draw(const std::string& text, const glm::vec2& pos, const ci::ColorA& color) noexcept
 {
+  PROFILE_SCOPE("Font::draw");
+
   unsigned char r8 = color.r * 255.0f;
   unsigned char g8 = color.g * 255.0f;
   unsigned char b8 = color.b * 255.0f;
@@ -42,3 +42,7 @@
 #include "AppText.hpp"
 #undef NGS_APPTEXT_IMPLEMENTATION
 
+#define NGS_PROFILER_IMPLEMENTATION
+#include "Profiler.hpp"
+#undef  NGS_PROFILER_IMPLEMENTATION
+
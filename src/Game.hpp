@@ -39,8 +39,16 @@ struct Game
     }
 
     // 乱数
-    std::random_device seed_gen;
-    engine_ = std::mt19937(seed_gen());
+    // TIPS 性能計測モードではseedが指定される(毎回同じ手札になる)
+    if (params.hasChild("seed"))
+    {
+      engine_ = std::mt19937(params.getValueForKey<uint32_t>("seed"));
+    }
+    else
+    {
+      std::random_device seed_gen;
+      engine_ = std::mt19937(seed_gen());
+    }
   }
 
   ~Game() = default;
@@ -324,6 +332,14 @@ struct Game
     panel_moved_times_ += 1;
   }
 
+  // これから配置するパネル(最初のパネル→配置順)
+  std::vector<int> getUpcomingPanels() const noexcept
+  {
+    std::vector<int> panels{ start_panel_ };
+    panels.insert(std::end(panels), std::begin(waiting_panels), std::end(waiting_panels));
+    return panels;
+  }
+
   // 手持ちパネル情報
   u_int getHandPanel() const noexcept
   {
@@ -453,8 +469,8 @@ struct Game
   }
 
 
-  // 保存
-  void save(const std::string& name) const noexcept
+  // 盤面などをJSONにする
+  std::string serialize() const noexcept
   {
     ci::JsonTree save_data;
 
@@ -472,14 +488,7 @@ struct Game
              .addChild(ci::JsonTree("tutorial", is_tutorial_))
              ;
 
-
-#if defined(OBFUSCATION_GAME_RECORD)
-    TextCodec::write((getDocumentPath() / name).string(), save_data.serialize());
-#else
-    save_data.write(getDocumentPath() / name);
-#endif
-
-    DOUT << "Game saved: " << name << std::endl;
+    return save_data.serialize();
   }
 
   // NOTE pathはfull path
@@ -496,29 +505,27 @@ struct Game
       return;
     }
 
-    ci::JsonTree json;
 #if defined (OBFUSCATION_GAME_RECORD)
     auto text = TextCodec::load(path.string());
-    try
-    {
-      json = ci::JsonTree(text);
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
-    {
-      DOUT << "Game record broken." << std::endl;
-      return;
-    }
 #else
+    auto text = ci::loadString(ci::loadFile(path));
+#endif
+    restore(text, delay);
+  }
+
+  // serialize()したものから復元
+  void restore(const std::string& text, double delay = 0.0)
+  {
+    ci::JsonTree json;
     try
     {
-      json = ci::JsonTree(ci::loadFile(path));
+      json = ci::JsonTree(text);
     }
     catch (ci::JsonTree::ExcJsonParserError&)
     {
       DOUT << "Game record broken." << std::endl;
       return;
     }
-#endif
 
     count_exec_.clear();
 
@@ -164,7 +164,7 @@ void writeCachedAchievement()
 
   auto full_path = getDocumentPath() / "achievements.cache";
 #if defined (OBFUSCATION_ACHIEVEMENT)
-  TextCodec::write(full_path.string(), json.serialize());
+  TextCodec::write(full_path.string(), json.serialize(), Codec::Usage::ARCHIVE);
 #else
   json.write(full_path);
 #endif
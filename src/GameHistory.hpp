@@ -0,0 +1,413 @@
+﻿#pragma once
+
+//
+// プレイ履歴
+//   全てのプレイ結果を追記専用のログへ記録する
+//   ログは一定のレコード数ごとのファイル(セグメント)に分かれている
+//   レコードの先頭には要約があり、本体を展開せずに集計できる
+//   圧縮と書き出しはAsyncFileWriterのスレッドで行う
+//   TIPS 書き込み途中で終了したセグメントには追記せず、次のセグメントから書く
+//
+//   RecordHeader
+//   本体(Game::serialize()を圧縮したもの) × size
+//   RecordHeader
+//   ...
+//
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include <boost/noncopyable.hpp>
+#include <zlib.h>
+#include "Score.hpp"
+#include "TextCodec.hpp"
+#include "MappedFile.hpp"
+#include "AsyncFileWriter.hpp"
+
+
+namespace ngs {
+
+class GameHistory
+  : private boost::noncopyable
+{
+public:
+  enum : uint32_t
+  {
+    VERSION = 1,
+    // これだけ書いたら次のセグメントへ
+    // TIPS 識別子を書き出す前に決めるため、大きさではなく数で区切る
+    SEGMENT_RECORDS = 256,
+  };
+
+  // 1ゲームの要約
+  struct Summary
+  {
+    // 記録した時刻(UNIX時間)
+    int64_t  time;
+
+    uint32_t score;
+    uint32_t rank;
+    uint32_t panels;
+    uint32_t panel_turned_times;
+    uint32_t panel_moved_times;
+    uint32_t max_forest;
+    uint32_t max_path;
+    uint32_t perfect;
+
+    double   limit_time;
+  };
+
+  struct RecordHeader
+  {
+    char     magic[4];
+    uint32_t version;
+    // 本体のサイズとCRC32
+    uint32_t size;
+    uint32_t crc32;
+
+    Summary  summary;
+  };
+
+  static_assert(sizeof(Summary)      == 48, "GameHistory::Summary");
+  static_assert(sizeof(RecordHeader) == 64, "GameHistory::RecordHeader");
+
+
+  static Summary makeSummary(const Score& score) noexcept
+  {
+    auto max_value = [](const std::vector<u_int>& values) noexcept
+                     {
+                       auto it = std::max_element(std::begin(values), std::end(values));
+                       return uint32_t(it != std::end(values) ? *it : 0);
+                     };
+
+    Summary summary{ };
+    summary.time               = int64_t(std::time(nullptr));
+    summary.score              = score.total_score;
+    summary.rank               = score.total_ranking;
+    summary.panels             = score.total_panels;
+    summary.panel_turned_times = score.panel_turned_times;
+    summary.panel_moved_times  = score.panel_moved_times;
+    summary.max_forest         = max_value(score.forest);
+    summary.max_path           = max_value(score.path);
+    summary.perfect            = score.perfect;
+    summary.limit_time         = score.limit_time;
+
+    return summary;
+  }
+
+  // append()が返す識別子か？
+  // TIPS それ以外は以前の形式(ゲームごとのファイル)
+  static bool isRecord(const std::string& id) noexcept
+  {
+    return !id.empty() && id[0] == '#';
+  }
+
+
+private:
+  static const char* magic() noexcept
+  {
+    return "NGSH";
+  }
+
+  // 識別子は "#セグメント番号:セグメント内の番号"
+  static std::string makeId(uint32_t segment, uint32_t index) noexcept
+  {
+    char id[32];
+    std::sprintf(id, "#%06u:%u", segment, index);
+    return id;
+  }
+
+  static bool parseId(const std::string& id, uint32_t& segment, uint32_t& index) noexcept
+  {
+    unsigned int s;
+    unsigned int i;
+    if (std::sscanf(id.c_str(), "#%u:%u", &s, &i) != 2) return false;
+
+    segment = s;
+    index   = i;
+    return true;
+  }
+
+  static uint32_t calcCrc(const void* data, size_t size) noexcept
+  {
+    return uint32_t(crc32(crc32(0, Z_NULL, 0), static_cast<const Bytef*>(data), uInt(size)));
+  }
+
+  // 先頭から正しいレコードを調べる
+  //   verify: 本体のCRCも確認する
+  //   func(offset, header)
+  // 戻り値:正しいレコードの終わり
+  template <typename F>
+  static size_t scan(const MappedFile& file, bool verify, F func) noexcept
+  {
+    const auto* data = static_cast<const char*>(file.data());
+    auto size = file.size();
+
+    size_t offset = 0;
+    while ((size - offset) >= sizeof(RecordHeader))
+    {
+      RecordHeader header;
+      std::memcpy(&header, data + offset, sizeof(header));
+      if (std::memcmp(header.magic, magic(), sizeof(header.magic))
+          || header.version != VERSION
+          || (size - offset - sizeof(header)) < header.size)
+      {
+        break;
+      }
+      if (verify && calcCrc(data + offset + sizeof(header), header.size) != header.crc32)
+      {
+        break;
+      }
+
+      func(offset, header);
+      offset += sizeof(header) + header.size;
+    }
+
+    return offset;
+  }
+
+  ci::fs::path getSegmentPath(uint32_t segment) const noexcept
+  {
+    char name[32];
+    std::sprintf(name, "%06u.log", segment);
+    return dir_ / name;
+  }
+
+  // 追記するセグメントを決める
+  void open() noexcept
+  {
+    segment_ = 0;
+    index_   = 0;
+    if (!ci::fs::is_directory(dir_)) return;
+
+    bool found = false;
+    for (const auto& entry : ci::fs::directory_iterator(dir_))
+    {
+      unsigned int segment;
+      char ext[8];
+      if (std::sscanf(entry.path().filename().string().c_str(), "%u.%7s", &segment, ext) == 2
+          && !std::strcmp(ext, "log"))
+      {
+        segment_ = found ? std::max(segment_, uint32_t(segment)) : uint32_t(segment);
+        found    = true;
+      }
+    }
+    if (!found) return;
+
+    // 最後のセグメントが壊れていないか調べる
+    MappedFile file(getSegmentPath(segment_).string());
+    uint32_t num = 0;
+    auto size = scan(file, true,
+                     [&num](size_t, const RecordHeader&) noexcept
+                     {
+                       num += 1;
+                     });
+    if (size != file.size() || num >= SEGMENT_RECORDS)
+    {
+      DOUT << "GameHistory: next segment." << std::endl;
+      segment_ += 1;
+      return;
+    }
+    index_ = num;
+  }
+
+  // 圧縮して追記(書き出し用のスレッドで呼ばれる)
+  void write(uint32_t segment, const Summary& summary, const std::string& game) noexcept
+  {
+    // 書き込みに失敗したセグメントに続けて書くと番号がずれる
+    if (segment == broken_segment_) return;
+
+    auto body = TextCodec::encode(game, Codec::Usage::GAME_RECORD);
+    if (body.empty())
+    {
+      DOUT << "GameHistory: encode error." << std::endl;
+      fail(segment);
+      return;
+    }
+
+    RecordHeader header{ };
+    std::memcpy(header.magic, magic(), sizeof(header.magic));
+    header.version = VERSION;
+    header.size    = uint32_t(body.size());
+    header.crc32   = calcCrc(body.data(), body.size());
+    header.summary = summary;
+
+    try
+    {
+      ci::fs::create_directories(dir_);
+    }
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+      fail(segment);
+      return;
+    }
+
+    auto path = getSegmentPath(segment);
+    auto* fp = std::fopen(path.string().c_str(), "ab");
+    if (!fp)
+    {
+      fail(segment);
+      return;
+    }
+
+    // TIPS ランキングの記録より先にディスクへ反映させる
+    bool result = std::fwrite(&header, sizeof(header), 1, fp) == 1
+                  && std::fwrite(body.data(), 1, body.size(), fp) == body.size()
+                  && AsyncFileWriter::sync(fp);
+    result = (std::fclose(fp) == 0) && result;
+    if (!result)
+    {
+      DOUT << "GameHistory: write error: " << path << std::endl;
+      fail(segment);
+    }
+  }
+
+  // 途中まで書いたかもしれないので、以降は次のセグメントへ
+  void fail(uint32_t segment) noexcept
+  {
+    broken_segment_ = segment;
+    failed_ = true;
+  }
+
+
+public:
+  GameHistory(const ci::fs::path& dir, AsyncFileWriter& writer) noexcept
+    : dir_(dir),
+      writer_(writer)
+  {
+    open();
+  }
+
+  ~GameHistory()
+  {
+    // NOTICE 書き出し待ちの処理が自身を参照している
+    writer_.flush();
+  }
+
+
+  // 追記
+  //   game: Game::serialize()
+  //   圧縮と書き出しは後で行う
+  // 戻り値:識別子(書き込みに失敗した時は読めない)
+  std::string append(const Summary& summary, std::string game) noexcept
+  {
+    if (failed_.exchange(false) || index_ >= SEGMENT_RECORDS)
+    {
+      segment_ += 1;
+      index_    = 0;
+    }
+
+    auto segment = segment_;
+    auto id = makeId(segment_, index_);
+    index_ += 1;
+
+    writer_.run([this, segment, summary, game = std::move(game)]() noexcept
+                {
+                  write(segment, summary, game);
+                });
+    DOUT << "GameHistory: append: " << id << std::endl;
+
+    return id;
+  }
+
+  // 読み込み
+  //   game: Game::restore()に渡す
+  // 戻り値:false 記録が無いか壊れている
+  bool read(const std::string& id, std::string& game) const noexcept
+  {
+    uint32_t segment;
+    uint32_t index;
+    if (!parseId(id, segment, index)) return false;
+
+    // 書き出し待ちかもしれない
+    writer_.flush();
+
+    MappedFile file(getSegmentPath(segment).string());
+    if (!file.isOpen()) return false;
+
+    // 要約を辿って探す
+    const auto* data = static_cast<const char*>(file.data());
+    const char* record = nullptr;
+    uint32_t num = 0;
+    scan(file, false,
+         [&](size_t offset, const RecordHeader&) noexcept
+         {
+           if (num == index) record = data + offset;
+           num += 1;
+         });
+    if (!record) return false;
+
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    if (calcCrc(record + sizeof(header), header.size) != header.crc32)
+    {
+      DOUT << "GameHistory: broken: " << id << std::endl;
+      return false;
+    }
+
+    game = TextCodec::decode(record + sizeof(header), header.size);
+    return !game.empty();
+  }
+
+  // 全ての記録の要約を古い順に調べる
+  //   func(const Summary&)
+  // TIPS 要約だけを読むので本体は展開しない
+  template <typename F>
+  void forEach(F func) const noexcept
+  {
+    writer_.flush();
+
+    for (uint32_t segment = 0; segment <= segment_; ++segment)
+    {
+      MappedFile file(getSegmentPath(segment).string());
+      if (!file.isOpen()) continue;
+
+      scan(file, false,
+           [&func](size_t, const RecordHeader& header)
+           {
+             func(header.summary);
+           });
+    }
+  }
+
+  // 全て消去
+  void erase() noexcept
+  {
+    writer_.flush();
+
+    try
+    {
+      ci::fs::remove_all(dir_);
+    }
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+    }
+
+    segment_ = 0;
+    index_   = 0;
+    broken_segment_ = std::numeric_limits<uint32_t>::max();
+    failed_ = false;
+  }
+
+
+private:
+  ci::fs::path dir_;
+  AsyncFileWriter& writer_;
+
+  // 追記先
+  uint32_t segment_;
+  uint32_t index_;
+
+  // 書き込みに失敗したセグメント(書き出し用のスレッドだけが触る)
+  uint32_t broken_segment_ = std::numeric_limits<uint32_t>::max();
+  // 書き込みに失敗したのでセグメントを変える
+  std::atomic<bool> failed_ { false };
+};
+
+}
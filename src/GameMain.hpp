@@ -26,12 +26,11 @@ public:
 
 
   GameMain(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-           const Condition& condition) noexcept
+           UI::CanvasCache& canvas_cache, const Condition& condition) noexcept
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("gamemain.canvas")),
-              Params::load(params.getValueForKey<std::string>("gamemain.tweens"))),
+              canvas_cache.get(params, "gamemain")),
       timeline_(ci::Timeline::create()),
       scores_(3, 0)
   {
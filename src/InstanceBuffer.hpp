@@ -0,0 +1,151 @@
+﻿#pragma once
+
+//
+// インスタンシング用の頂点バッファ
+//   CPU側の写しと比較して、値が変わった範囲だけ転送する
+//   何も変わらないフレームは転送しない
+//
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <boost/noncopyable.hpp>
+#include <cinder/gl/Vbo.h>
+
+
+namespace ngs {
+
+template <typename T>
+class InstanceBuffer
+  : private boost::noncopyable
+{
+  // NOTICE memcmpで比較するので詰め物の無い型を使う
+  static_assert(std::is_trivially_copyable<T>::value, "InstanceBuffer: T must be trivially copyable.");
+
+  ci::gl::VboRef vbo_;
+  std::vector<T> data_;
+
+  // 転送が必要な範囲[begin, end)
+  size_t dirty_begin_ = 0;
+  size_t dirty_end_   = 0;
+
+
+  void markDirty(size_t begin, size_t end) noexcept
+  {
+    if (dirty_begin_ >= dirty_end_)
+    {
+      dirty_begin_ = begin;
+      dirty_end_   = end;
+      return;
+    }
+
+    dirty_begin_ = std::min(dirty_begin_, begin);
+    dirty_end_   = std::max(dirty_end_, end);
+  }
+
+
+public:
+  explicit InstanceBuffer(size_t capacity) noexcept
+    : vbo_(ci::gl::Vbo::create(GL_ARRAY_BUFFER, std::max<size_t>(capacity, 1) * sizeof(T), nullptr, GL_DYNAMIC_DRAW))
+  {
+    data_.reserve(capacity);
+  }
+
+  ~InstanceBuffer() = default;
+
+
+  const ci::gl::VboRef& vbo() const noexcept
+  {
+    return vbo_;
+  }
+
+  size_t size() const noexcept
+  {
+    return data_.size();
+  }
+
+  bool empty() const noexcept
+  {
+    return data_.empty();
+  }
+
+  const T& operator[](size_t index) const noexcept
+  {
+    return data_[index];
+  }
+
+
+  // 増えた分は転送対象
+  void resize(size_t num) noexcept
+  {
+    auto prev = data_.size();
+    data_.resize(num);
+
+    if (num > prev)
+    {
+      markDirty(prev, num);
+    }
+    else
+    {
+      dirty_end_ = std::min(dirty_end_, num);
+    }
+  }
+
+  void clear() noexcept
+  {
+    data_.clear();
+    dirty_begin_ = dirty_end_ = 0;
+  }
+
+  // 値が変わった時だけ転送対象にする
+  void set(size_t index, const T& value) noexcept
+  {
+    auto& v = data_[index];
+    if (!std::memcmp(&v, &value, sizeof(T))) return;
+
+    v = value;
+    markDirty(index, index + 1);
+  }
+
+  // 先頭から詰め直す時用
+  //   末尾を超えたら伸ばす
+  void store(size_t index, const T& value) noexcept
+  {
+    if (index >= data_.size()) resize(index + 1);
+    set(index, value);
+  }
+
+
+  bool isDirty() const noexcept
+  {
+    return dirty_begin_ < dirty_end_;
+  }
+
+  // 変わった範囲をまとめて転送
+  void upload() noexcept
+  {
+    if (!isDirty()) return;
+
+    auto size = data_.size() * sizeof(T);
+    if (size > size_t(vbo_->getSize()))
+    {
+      // 足りない時は確保し直して全体を転送
+      // TIPS バッファオブジェクトは同じなのでVAOはそのまま使える
+      auto capacity = std::max(size, size_t(vbo_->getSize()) * 2);
+      vbo_->bufferData(capacity, nullptr, GL_DYNAMIC_DRAW);
+      vbo_->bufferSubData(0, size, data_.data());
+    }
+    else
+    {
+      vbo_->bufferSubData(dirty_begin_ * sizeof(T),
+                          (dirty_end_ - dirty_begin_) * sizeof(T),
+                          &data_[dirty_begin_]);
+    }
+
+    dirty_begin_ = dirty_end_ = 0;
+  }
+
+};
+
+}
@@ -25,12 +25,11 @@ public:
 
 
   Intro(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-        const Condition& condition)
+        UI::CanvasCache& canvas_cache, const Condition& condition)
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("intro.canvas")),
-              Params::load(params.getValueForKey<std::string>("intro.tweens"))),
+              canvas_cache.get(params, "intro")),
       finish_delay_(params.getValueForKey<double>("intro.finish_delay"))
   {
     startTimelineSound(event, params, "intro.se");
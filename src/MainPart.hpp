@@ -356,6 +356,7 @@ public:
                                 is_tutorial_ = getValue(args, "force-tutorial", is_tutorial_);
 
                                 game_->setupPanels(is_tutorial_);
+                                view_.prefetchPanels(game_->getUpcomingPanels());
 
                                 // NOTICE 開始演出終わりに残り時間が正しく表示されているために必要
                                 game_->updateGameUI();
@@ -426,8 +427,7 @@ public:
                               [this](const Connection&, const Arguments&) noexcept
                               {
                                 // 中断
-                                archive_.addRecord("abort-times", uint32_t(1));
-                                archive_.save();
+                                archive_.modify().abort_times += 1;
                                 view_.endPlay();
                                 count_exec_.add(params_.getValueForKey<double>("field.game_abort_delay"),
                                                 [this]() noexcept
@@ -481,7 +481,7 @@ public:
                                 {
                                   // Tutorial完了
                                   event_.signal("Game:Tutorial-Finish"s, Arguments());
-                                  archive_.setRecord("tutorial", false);
+                                  archive_.modify().tutorial = false;
                                 }
 
                                 // スコア計算
@@ -493,7 +493,7 @@ public:
                                 auto ranking = getRanking(score.total_score);
 
                                 // 総設置パネル数
-                                auto total_panels = archive_.getRecord<u_int>("total-panels");
+                                auto total_panels = archive_.get().total_panels;
                                 // 最大森
                                 auto max_forest = getValue<u_int>(args, "max_forest");
                                 // 最長道
@@ -1346,105 +1346,75 @@ private:
   bool isHighScore(const Score& score) const noexcept
   {
     // ハイスコア判定
-    auto high_score = archive_.getRecord<u_int>("high-score");
+    auto high_score = archive_.get().high_score;
     return score.total_score > high_score;
   }
 
   // Gameの記録
   void recordGameScore(const Score& score, bool high_score)
   {
-    archive_.setRecord("saved", true); 
+    archive_.modify().saved = true;
     
-    auto path = std::string("game-") + getFormattedDate() + ".json";
-    game_->save(path);
-    // pathを記録
-    auto game_json = ci::JsonTree::makeObject();
-    game_json.addChild(ci::JsonTree("path",  path))
-             .addChild(ci::JsonTree("score", score.total_score))
-             .addChild(ci::JsonTree("rank",  score.total_ranking))
-    ;
-
-    // 過去の記録の先頭にプレイ結果を追加する
-    auto json = ci::JsonTree::makeArray("games");
-    json.pushBack(game_json);
-    const auto& games = archive_.getRecordArray("games");
-    for (const auto& g : games)
-    {
-      json.pushBack(g);
-    }
-                                  
-    Json::sort(json,
-               [](const ci::JsonTree& a, const ci::JsonTree& b) noexcept
-               {
-                 auto score_a = a.getValueForKey<u_int>("score");
-                 auto score_b = b.getValueForKey<u_int>("score");
-                 return score_a < score_b;
-               });
-
-    // ランキング圏外を捨てる
-    if (json.getNumChildren() > ranking_records_)
-    {
-      size_t count = json.getNumChildren() - ranking_records_;
-      for (size_t i = 0; i < count; ++i)
-      {
+    // 履歴に追記して、その識別子をランキングに記録
+    auto id = archive_.history().append(GameHistory::makeSummary(score), game_->serialize());
+
+    // TIPS ランキング圏外になったものは返ってくる
+    auto removed = archive_.addGame(score.total_score, score.total_ranking, id, ranking_records_);
 #if defined (REMOVE_UNNECESSARY_RECORD)
-        if (json[ranking_records_].hasChild("path"))
-        {
-          auto p = json[ranking_records_].getValueForKey<std::string>("path");
-          auto full_path = getDocumentPath() / p;
-          // ファイルを削除
-          try
-          {
-            DOUT << "remove: " << full_path << std::endl;
-            ci::fs::remove(full_path);
-          }
-          catch (ci::fs::filesystem_error& ex)
-          {
-            DOUT << ex.what() << std::endl;
-          }
-        }
-#endif
+    for (const auto& p : removed)
+    {
+      // 履歴は消さない
+      if (GameHistory::isRecord(p)) continue;
 
-        json.removeChild(ranking_records_);
+      // 以前の形式はファイルを削除
+      auto full_path = getDocumentPath() / p;
+      // ファイルを削除
+      try
+      {
+        DOUT << "remove: " << full_path << std::endl;
+        ci::fs::remove(full_path);
+      }
+      catch (ci::fs::filesystem_error& ex)
+      {
+        DOUT << ex.what() << std::endl;
       }
     }
-    archive_.setRecordArray("games", json);
+#endif
     archive_.recordGameResults(score, high_score);
   }
 
   bool isRankIn(u_int score) const noexcept
   {
-    const auto& ranking = archive_.getRecordArray("games");
-    return std::any_of(std::begin(ranking), std::end(ranking),
-                       [score](const auto& r)
+    const auto& data = archive_.get();
+    return std::any_of(data.games, data.games + data.game_num,
+                       [score](const ArchiveData::Game& r) noexcept
                        {
-                         return score == r.template getValueForKey<u_int>("score");
+                         return score == r.score;
                        });
   }
 
   u_int getRanking(u_int score) const noexcept
   {
-    const auto& ranking = archive_.getRecordArray("games");
-    auto it = std::find_if(std::begin(ranking), std::end(ranking),
-                           [score](const auto& r)
+    const auto& data = archive_.get();
+    auto it = std::find_if(data.games, data.games + data.game_num,
+                           [score](const ArchiveData::Game& r) noexcept
                            {
-                             return score == r.template getValueForKey<u_int>("score");
+                             return score == r.score;
                            });
-    return u_int(std::distance(std::begin(ranking), it));
+    return u_int(std::distance(data.games, it));
   }
 
 
   // 記録の消去
   void eraseRecords() noexcept
   {
-    // 保存してあるプレイ結果を削除
-    auto game_records = archive_.getRecordArray("games");
-    for (const auto& game : game_records)
+    // 以前の形式で保存してあるプレイ結果を削除
+    // TIPS 履歴はarchive_.erase()で消える
+    for (const auto& game : archive_.getGames())
     {
-      if (game.hasChild("path"))
+      if (game.path[0] && !GameHistory::isRecord(game.path))
       {
-        auto p = game.getValueForKey<std::string>("path");
-        auto full_path = getDocumentPath() / p;
+        auto full_path = getDocumentPath() / game.path;
         // ファイルを削除
         try
         {
@@ -1475,15 +1445,31 @@ private:
     field_camera_.force(true);
     manipulated_ = false;
 
-    const auto& json = archive_.getRecordArray("games");
-    if (json.hasChildren() && json[rank].hasChild("path"))
+    const auto& data = archive_.get();
+    if (u_int(rank) < data.game_num && data.games[rank].path[0])
     {
-      // view_.clearAll();
-      auto delay = view_.removeFieldPanels();
-      auto full_path = getDocumentPath() / json[rank].getValueForKey<std::string>("path");
-      game_->load(full_path, delay);
-      calcViewRange(false);
-      game_event_.insert("Panel:clear"s);
+      std::string path = data.games[rank].path;
+      std::string game;
+      if (GameHistory::isRecord(path) && !archive_.history().read(path, game))
+      {
+        DOUT << "No game data." << std::endl;
+      }
+      else
+      {
+        // view_.clearAll();
+        auto delay = view_.removeFieldPanels();
+        if (game.empty())
+        {
+          // 以前の形式
+          game_->load(getDocumentPath() / path, delay);
+        }
+        else
+        {
+          game_->restore(game, delay);
+        }
+        calcViewRange(false);
+        game_event_.insert("Panel:clear"s);
+      }
     }
 
     count_exec_.add(params_.getValueForKey<double>("field.auto_camera_duration"),
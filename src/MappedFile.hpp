@@ -0,0 +1,98 @@
+﻿#pragma once
+
+//
+// 読み込み専用のメモリマップドファイル
+//   ファイル全体をマップし、破棄するまで有効
+//   開けなかった場合はisOpen()がfalse
+//
+
+#include "Defines.hpp"
+#include <string>
+#include <boost/noncopyable.hpp>
+
+#if !defined (_MSC_VER)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace ngs {
+
+class MappedFile
+  : private boost::noncopyable
+{
+  const void* data_ = nullptr;
+  size_t size_      = 0;
+
+#if defined (_MSC_VER)
+  HANDLE file_    = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#endif
+
+
+public:
+  explicit MappedFile(const std::string& path) noexcept
+  {
+#if defined (_MSC_VER)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || !size.QuadPart) return;
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) return;
+
+    data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (data_) size_ = size_t(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      auto* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+      {
+        data_ = p;
+        size_ = size_t(st.st_size);
+      }
+    }
+    // TIPS マップした後は閉じても良い
+    ::close(fd);
+#endif
+  }
+
+  ~MappedFile()
+  {
+#if defined (_MSC_VER)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+    if (data_) ::munmap(const_cast<void*>(data_), size_);
+#endif
+  }
+
+
+  bool isOpen() const noexcept
+  {
+    return data_ != nullptr;
+  }
+
+  const void* data() const noexcept
+  {
+    return data_;
+  }
+
+  size_t size() const noexcept
+  {
+    return size_;
+  }
+};
+
+}
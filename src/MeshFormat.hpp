@@ -0,0 +1,194 @@
+﻿#pragma once
+
+//
+// パネル用のバイナリメッシュ形式(.bmesh)
+//   量子化した頂点とuint16の頂点インデックスをそのまま並べたもの
+//   メモリマップしたデータから一回の走査でGPU用の頂点配列へ展開する
+//   頂点は全LODで共有し、頂点インデックスだけLODごとに持つ
+//   NOTICE tools/meshconv からも使うのでCinderに依存しないこと
+//
+//   Header
+//   PackedVertex × vertex_num
+//   uint16_t     × index_num[0]  LOD0(最も詳細)
+//   uint16_t     × index_num[1]  LOD1
+//   ...
+//
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+
+namespace ngs { namespace MeshFormat {
+
+enum : uint32_t
+{
+  VERSION = 2,
+  LOD_MAX = 4,
+};
+
+constexpr char MAGIC[4] = { 'N', 'G', 'S', 'M' };
+
+
+struct Header
+{
+  char     magic[4];
+  uint32_t version;
+  uint32_t vertex_num;
+  uint32_t lod_num;
+  // 位置の量子化範囲(そのままAABBになる)
+  float    min[3];
+  float    max[3];
+  uint32_t index_num[LOD_MAX];
+};
+
+// 保存形式
+struct PackedVertex
+{
+  uint16_t position[3];
+  int8_t   normal[3];
+  uint8_t  color[3];
+};
+
+// GPUへ転送する形式
+struct Vertex
+{
+  float position[3];
+  float normal[3];
+  float color[3];
+};
+
+static_assert(sizeof(Header)       == 56, "MeshFormat::Header");
+static_assert(sizeof(PackedVertex) == 12, "MeshFormat::PackedVertex");
+
+
+// データサイズ
+inline size_t calcSize(const Header& header) noexcept
+{
+  size_t size = sizeof(Header) + sizeof(PackedVertex) * header.vertex_num;
+  for (uint32_t i = 0; i < header.lod_num; ++i)
+  {
+    size += sizeof(uint16_t) * header.index_num[i];
+  }
+  return size;
+}
+
+// 戻り値:nullptr 形式が違う
+inline const Header* getHeader(const void* data, size_t size) noexcept
+{
+  if (size < sizeof(Header)) return nullptr;
+
+  const auto* header = static_cast<const Header*>(data);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC))
+      || header->version != VERSION
+      || header->lod_num == 0
+      || header->lod_num > LOD_MAX
+      || size < calcSize(*header))
+  {
+    return nullptr;
+  }
+
+  return header;
+}
+
+// LODの頂点インデックス(index_num[lod]個)
+inline const uint16_t* getIndices(const Header& header, uint32_t lod) noexcept
+{
+  auto* indices = reinterpret_cast<const uint16_t*>(reinterpret_cast<const PackedVertex*>(&header + 1) + header.vertex_num);
+  for (uint32_t i = 0; i < lod; ++i)
+  {
+    indices += header.index_num[i];
+  }
+  return indices;
+}
+
+// 頂点の展開
+//   vertices: vertex_num個の領域を用意しておく
+inline void decode(const Header& header, Vertex* vertices) noexcept
+{
+  const auto* packed = reinterpret_cast<const PackedVertex*>(&header + 1);
+
+  float scale[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    scale[i] = (header.max[i] - header.min[i]) / 65535.0f;
+  }
+
+  for (uint32_t i = 0; i < header.vertex_num; ++i)
+  {
+    const auto& src = packed[i];
+    auto& dst = vertices[i];
+    for (int j = 0; j < 3; ++j)
+    {
+      dst.position[j] = header.min[j] + src.position[j] * scale[j];
+      dst.normal[j]   = std::max(src.normal[j] / 127.0f, -1.0f);
+      dst.color[j]    = src.color[j] / 255.0f;
+    }
+  }
+}
+
+
+// 量子化して書き出し用のデータを作る
+//   lods: LODごとの頂点インデックス(0が最も詳細)
+//   戻り値:empty 頂点かLODが多すぎる
+inline std::vector<char> encode(const std::vector<Vertex>& vertices, const std::vector<std::vector<uint32_t>>& lods) noexcept
+{
+  if (vertices.empty() || vertices.size() > 65536) return { };
+  if (lods.empty() || lods.size() > LOD_MAX) return { };
+
+  Header header{ };
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version    = VERSION;
+  header.vertex_num = uint32_t(vertices.size());
+  header.lod_num    = uint32_t(lods.size());
+  for (size_t i = 0; i < lods.size(); ++i)
+  {
+    header.index_num[i] = uint32_t(lods[i].size());
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    header.min[i] = vertices[0].position[i];
+    header.max[i] = vertices[0].position[i];
+  }
+  for (const auto& v : vertices)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      header.min[i] = std::min(header.min[i], v.position[i]);
+      header.max[i] = std::max(header.max[i], v.position[i]);
+    }
+  }
+
+  std::vector<char> data(calcSize(header));
+  std::memcpy(&data[0], &header, sizeof(header));
+
+  auto* packed = reinterpret_cast<PackedVertex*>(&data[sizeof(header)]);
+  for (size_t i = 0; i < vertices.size(); ++i)
+  {
+    const auto& src = vertices[i];
+    auto& dst = packed[i];
+    for (int j = 0; j < 3; ++j)
+    {
+      auto range = header.max[j] - header.min[j];
+      auto p = (range > 0.0f) ? (src.position[j] - header.min[j]) / range : 0.0f;
+      dst.position[j] = uint16_t(std::lround(p * 65535.0f));
+      dst.normal[j]   = int8_t(std::lround(std::min(std::max(src.normal[j], -1.0f), 1.0f) * 127.0f));
+      dst.color[j]    = uint8_t(std::lround(std::min(std::max(src.color[j], 0.0f), 1.0f) * 255.0f));
+    }
+  }
+
+  auto* dst_indices = reinterpret_cast<uint16_t*>(packed + vertices.size());
+  for (const auto& indices : lods)
+  {
+    for (auto index : indices)
+    {
+      *dst_indices++ = uint16_t(index);
+    }
+  }
+
+  return data;
+}
+
+} }
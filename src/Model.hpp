@@ -2,11 +2,18 @@
 
 //
 // モデルの読み込み＆書き出し
+//   .bmesh(MeshFormat) → .mesh → .ply の順に探す
 // FIXME Panel専用
 //
 
 #include <cinder/DataTarget.h>
+#include <cinder/gl/VboMesh.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <fstream>
+#include "Asset.hpp"
 #include "PLY.hpp"
+#include "MeshFormat.hpp"
+#include "MappedFile.hpp"
 
 
 namespace ngs { namespace Model {
@@ -32,6 +39,118 @@ void writeTriMesh(const std::string& path, const ci::TriMesh& mesh)
 }
 
 
+// GPUへ転送できる状態の頂点データ
+struct MeshBuffer
+{
+  std::vector<MeshFormat::Vertex> vertices;
+  // LODごとの頂点インデックス(0が最も詳細)
+  std::vector<std::vector<uint16_t>> indices;
+  ci::AxisAlignedBox aabb;
+};
+
+
+// .bmeshのデータを展開
+// 戻り値:false 形式が違う
+bool decodeBinaryMesh(const void* data, size_t size, MeshBuffer& buffer) noexcept
+{
+  const auto* header = MeshFormat::getHeader(data, size);
+  if (!header) return false;
+
+  buffer.vertices.resize(header->vertex_num);
+  MeshFormat::decode(*header, buffer.vertices.data());
+
+  buffer.indices.resize(header->lod_num);
+  for (uint32_t i = 0; i < header->lod_num; ++i)
+  {
+    const auto* indices = MeshFormat::getIndices(*header, i);
+    buffer.indices[i].assign(indices, indices + header->index_num[i]);
+  }
+  buffer.aabb = ci::AxisAlignedBox(glm::make_vec3(header->min), glm::make_vec3(header->max));
+
+  return true;
+}
+
+// .bmeshをメモリマップして展開
+// 戻り値:false ファイルが無いか形式が違う
+bool loadBinaryMesh(const std::string& path, MeshBuffer& buffer) noexcept
+{
+  MappedFile file(path);
+  if (!file.isOpen()) return false;
+
+  if (!decodeBinaryMesh(file.data(), file.size(), buffer))
+  {
+    DOUT << "Invalid mesh: " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+// TriMesh → MeshBuffer
+MeshBuffer toMeshBuffer(const ci::TriMesh& mesh) noexcept
+{
+  assert(mesh.getNumVertices() <= 65536);
+
+  MeshBuffer buffer;
+
+  const auto* pos    = mesh.getPositions<3>();
+  const auto* normal = mesh.getNormals().data();
+  const auto* color  = mesh.getColors<3>();
+  buffer.vertices.resize(mesh.getNumVertices());
+  for (size_t i = 0; i < buffer.vertices.size(); ++i)
+  {
+    auto& v = buffer.vertices[i];
+    std::memcpy(v.position, &pos[i],    sizeof(v.position));
+    std::memcpy(v.normal,   &normal[i], sizeof(v.normal));
+    std::memcpy(v.color,    &color[i],  sizeof(v.color));
+  }
+
+  const auto& indices = mesh.getIndices();
+  buffer.indices.emplace_back(std::begin(indices), std::end(indices));
+  buffer.aabb = mesh.calcBoundingBox();
+
+  return buffer;
+}
+
+// 頂点データをそのままVBOへ転送
+//   頂点は共有し、LODごとのVboMeshを返す
+// NOTICE メインスレッド専用
+std::vector<ci::gl::VboMeshRef> createVboMeshes(const MeshBuffer& buffer) noexcept
+{
+  using Vertex = MeshFormat::Vertex;
+
+  ci::geom::BufferLayout layout;
+  layout.append(ci::geom::Attrib::POSITION, 3, sizeof(Vertex), offsetof(Vertex, position));
+  layout.append(ci::geom::Attrib::NORMAL,   3, sizeof(Vertex), offsetof(Vertex, normal));
+  layout.append(ci::geom::Attrib::COLOR,    3, sizeof(Vertex), offsetof(Vertex, color));
+
+  auto vbo = ci::gl::Vbo::create(GL_ARRAY_BUFFER, sizeof(Vertex) * buffer.vertices.size(), buffer.vertices.data(), GL_STATIC_DRAW);
+
+  std::vector<ci::gl::VboMeshRef> meshes;
+  for (const auto& indices : buffer.indices)
+  {
+    auto ibo = ci::gl::Vbo::create(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    meshes.push_back(ci::gl::VboMesh::create(uint32_t(buffer.vertices.size()), GL_TRIANGLES, { { layout, vbo } },
+                                             uint32_t(indices.size()), GL_UNSIGNED_SHORT, ibo));
+  }
+
+  return meshes;
+}
+
+// TriMeshを.bmesh形式で書き出す
+// TIPS LODはtools/meshconvで作る
+void writeBinaryMesh(const std::string& path, const ci::TriMesh& mesh)
+{
+  const auto& indices = mesh.getIndices();
+  auto buffer = toMeshBuffer(mesh);
+  auto data = MeshFormat::encode(buffer.vertices, { indices });
+
+  auto full_path = getAssetPath(path).replace_extension("bmesh");
+  std::ofstream ofs(full_path.string(), std::ios::binary);
+  ofs.write(data.data(), data.size());
+}
+
+
 // .meshがダメなら.plyを読む
 // FIXME Releaseビルドでは.meshのみ読む
 ci::TriMesh load(const std::string& path)
@@ -53,4 +172,21 @@ ci::TriMesh load(const std::string& path)
 #endif
 }
 
+// .bmeshが無ければ従来の形式から変換する
+// TIPS パックに含まれていればマップ済みの領域から直接展開する
+MeshBuffer loadBuffer(const std::string& path)
+{
+  auto bmesh_name = ci::fs::path(path).replace_extension("bmesh").string();
+  MeshBuffer buffer;
+
+  const void* data;
+  size_t size;
+  if (Asset::find(bmesh_name, data, size) && decodeBinaryMesh(data, size, buffer)) return buffer;
+
+  auto bmesh_path = getAssetPath(bmesh_name);
+  if (loadBinaryMesh(bmesh_path.string(), buffer)) return buffer;
+
+  return toMeshBuffer(load(path));
+}
+
 } }
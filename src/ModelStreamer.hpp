@@ -0,0 +1,169 @@
+﻿#pragma once
+
+//
+// モデルの非同期読み込み
+//   専用スレッドで読み込み＆展開し、GPUへの転送はメインスレッドで行う
+//   優先度の高いもの(同じなら先に要求されたもの)から処理する
+//
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <boost/noncopyable.hpp>
+#include "Model.hpp"
+
+
+namespace ngs {
+
+class ModelStreamer
+  : private boost::noncopyable
+{
+public:
+  enum Priority
+  {
+    LOW,
+    // この後使われる
+    NEXT,
+    // 今すぐ必要
+    NOW,
+  };
+
+
+private:
+  struct Request
+  {
+    std::string path;
+    Priority priority;
+    u_int order;
+  };
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool running_ = true;
+
+  // 未着手の要求
+  std::vector<Request> requests_;
+  // 転送待ち
+  std::vector<std::pair<std::string, Model::MeshBuffer>> loaded_;
+
+  // 以下メインスレッド専用
+  // 要求済みのパスと、その優先度
+  // TIPS 読み込み済みは最高の優先度にしておく
+  std::map<std::string, Priority> requested_;
+  u_int order_ = 0;
+
+  std::thread thread_;
+
+
+  // 一番急ぐ要求を取り出す
+  // NOTICE mutex_をロックしてから呼ぶ
+  Request popRequest() noexcept
+  {
+    auto it = std::max_element(std::begin(requests_), std::end(requests_),
+                               [](const Request& a, const Request& b)
+                               {
+                                 if (a.priority != b.priority) return a.priority < b.priority;
+                                 return a.order > b.order;
+                               });
+    auto request = std::move(*it);
+    requests_.erase(it);
+    return request;
+  }
+
+  void threadMain() noexcept
+  {
+    while (true)
+    {
+      Request request;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]()
+                       {
+                         return !running_ || !requests_.empty();
+                       });
+        if (!running_) return;
+
+        request = popRequest();
+      }
+
+      auto buffer = Model::loadBuffer(request.path);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      loaded_.push_back({ request.path, std::move(buffer) });
+    }
+  }
+
+
+public:
+  ModelStreamer() noexcept
+    : thread_(&ModelStreamer::threadMain, this)
+  {}
+
+  ~ModelStreamer()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+
+  // 読み込み要求
+  // 読み込み中か読み込み済みなら何もしない。未着手なら優先度を上げる
+  // TIPS 毎フレーム呼ばれるので、同じ優先度での要求済みならロックしない
+  void request(const std::string& path, Priority priority) noexcept
+  {
+    auto requested = requested_.find(path);
+    if (requested != std::end(requested_))
+    {
+      if (requested->second >= priority) return;
+      requested->second = priority;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = std::find_if(std::begin(requests_), std::end(requests_),
+                             [&path](const Request& r)
+                             {
+                               return r.path == path;
+                             });
+      if (it == std::end(requests_)) return;
+
+      it->priority = priority;
+      it->order    = order_++;
+      return;
+    }
+    requested_.insert({ path, priority });
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requests_.push_back({ path, priority, order_++ });
+    }
+    cv_.notify_one();
+  }
+
+  // 読み込みが終わったものを受け取る
+  //   func(path, buffer)
+  template <typename F>
+  void update(F func) noexcept
+  {
+    std::vector<std::pair<std::string, Model::MeshBuffer>> loaded;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (loaded_.empty()) return;
+      loaded.swap(loaded_);
+    }
+
+    for (const auto& it : loaded)
+    {
+      requested_[it.first] = NOW;
+      func(it.first, it.second);
+    }
+  }
+};
+
+}
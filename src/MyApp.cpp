@@ -15,7 +15,10 @@
 #include "JsonUtil.hpp"
 #include "TouchEvent.hpp"
 #include "Core.hpp"
+#include "Path.hpp"
 #include "Debug.hpp"
+#include "Profiler.hpp"
+#include "Benchmark.hpp"
 #include "GameCenter.h"
 #include "PurchaseDelegate.h"
 
@@ -40,6 +43,7 @@ public:
     DOUT << "Resolution:  " << ci::app::toPixels(getWindowSize()) << std::endl;
 
     ci::Rand::randomize();
+    setupBenchmark();
     AppText::init(Os::lang());
 
 #if defined (DEBUG)
@@ -47,7 +51,8 @@ public:
     debug_events_ = Debug::keyEvent(params_["app.debug"]);
 #endif
 
-    if (!isFrameRateEnabled())
+    // NOTICE 性能計測時は描画待ちを含めない
+    if (!isFrameRateEnabled() && !benchmark_)
     {
       ci::gl::enableVerticalSync();
       DOUT << "enableVerticalSync." << std::endl;
@@ -157,6 +162,65 @@ public:
 
 
 private:
+  // 性能計測モード
+  //   乱数と経過時間を固定して毎回同じ内容を再現する
+  void setupBenchmark() noexcept
+  {
+    const auto& args = getCommandLineArgs();
+    auto it = std::find(std::begin(args), std::end(args), "--benchmark");
+    if (it == std::end(args) || (it + 1) == std::end(args)) return;
+
+    ci::JsonTree script(ci::loadFile(*(it + 1)));
+    auto seed = Json::getValue(script, "seed", 1u);
+    ci::randSeed(seed);
+    // Gameの乱数も固定する
+    // NOTICE Worker(Game)の生成前に呼ぶこと
+    params_["game"].addChild(ci::JsonTree("seed", seed));
+
+    // 記録は使い捨ての場所で、毎回初期状態から始める
+    // TIPS プレイヤーの記録を読み書きしない
+    try
+    {
+      auto dir = getDocumentPath() / "benchmark";
+      ci::fs::remove_all(dir);
+      ci::fs::create_directories(dir);
+    }
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+    }
+    params_["app"].addChild(ci::JsonTree("archive", "benchmark/records.data"));
+
+    benchmark_ = std::make_unique<Benchmark>(script, event_);
+
+    // 描画待ちを含めない
+    ci::gl::enableVerticalSync(false);
+    disableFrameRate();
+  }
+
+  // 結果を出力して終了
+  // NOTICE 実際の終了はcleanup()
+  void finishBenchmark() noexcept
+  {
+    benchmark_passed_ = benchmark_->report(std::cout);
+    quit();
+  }
+
+
+  void cleanup() noexcept override
+  {
+    // 記録の書き出しを待つ
+    worker_.reset();
+
+    if (benchmark_)
+    {
+      // TIPS CINDER_APPのmainは常に0を返す(OSXはmainに戻らない)ので
+      //      後始末を終えてから終了コードを返す
+      std::exit(benchmark_passed_ ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+
+
 	void mouseDown(ci::app::MouseEvent event) noexcept override
   {
     if (event.isLeft())
@@ -302,10 +366,19 @@ private:
 
 	void update() noexcept override
   {
+    Profiler::beginFrame();
     if (pending_update_) return;
 
+    PROFILE_SCOPE("update");
+
     auto current_time = getElapsedSeconds();
     auto delta_time   = current_time - prev_time_;
+    if (benchmark_)
+    {
+      current_time = benchmark_->currentTime();
+      delta_time   = benchmark_->deltaTime();
+      benchmark_->beginUpdate();
+    }
 #if defined (DEBUG)
     if (step_update_)
     {
@@ -321,6 +394,7 @@ private:
       };
       event_.signal("update", args);
     }
+    if (benchmark_) benchmark_->endUpdate();
 
 #if defined (DEBUG)
     if (step_update_)
@@ -337,14 +411,26 @@ private:
   {
     if (pending_draw_) return;
 
-    ci::gl::clear(ci::Color::black());
+    {
+      PROFILE_SCOPE("draw");
+
+      ci::gl::clear(ci::Color::black());
 
-    Arguments args = {
-      { "window_size", ci::app::getWindowSize() },
-    };
-    event_.signal("draw", args);
+      Arguments args = {
+        { "window_size", ci::app::getWindowSize() },
+      };
+      if (benchmark_) benchmark_->beginDraw();
+      event_.signal("draw", args);
+      if (benchmark_) benchmark_->endDraw();
+    }
+    Profiler::endFrame();
 
     pending_draw_ = pending_draw_next_;
+
+    if (benchmark_ && benchmark_->nextFrame())
+    {
+      finishBenchmark();
+    }
   }
 
 
@@ -358,6 +444,9 @@ private:
 
   std::unique_ptr<Worker> worker_;
 
+  std::unique_ptr<Benchmark> benchmark_;
+  bool benchmark_passed_ = false;
+
 #if defined (DEBUG)
   bool paused_      = false;
   bool step_update_ = false;
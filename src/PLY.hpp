@@ -3,15 +3,15 @@
 //
 // PLY読み込み
 // 
-// FIXME:MagicaVoxelから書き出したデータにのみ対応しているので
-//       かなり大雑把
+// 解析はPLYParser.hppで行い、TriMeshにする
 //
 
 #include "Defines.hpp"
 #include "Path.hpp"
-#include <sstream> 
+#include "PLYParser.hpp"
 #include <vector> 
 #include <glm/gtc/random.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 
 namespace ngs { namespace PLY {
@@ -21,118 +21,71 @@ ci::TriMesh optimize(const ci::TriMesh& mesh);
 
 #if defined (NGS_PLY_IMPLEMENTATION)
 
-std::vector<std::string> split(const std::string& text) noexcept
+// 解析結果→TriMesh
+ci::TriMesh toTriMesh(const Mesh& src)
 {
-  std::istringstream line_separater(text);
-  const char delimiter = ' ';
+  // 頂点カラーを含むTriMeshを準備
+  ci::TriMesh mesh(ci::TriMesh::Format().positions().normals().colors());
 
-  std::vector<std::string> split_text;
-  while (!line_separater.eof())
+  auto num = src.vertices.size();
+  std::vector<glm::vec3> positions(num);
+  std::vector<glm::vec3> normals(num);
+  std::vector<ci::Color> colors(num);
+  for (size_t i = 0; i < num; ++i)
   {
-    std::string separated_string;
-    std::getline(line_separater, separated_string, delimiter);
-    split_text.push_back(separated_string);
+    const auto& v = src.vertices[i];
+    positions[i] = glm::make_vec3(v.position);
+    normals[i]   = glm::make_vec3(v.normal);
+    colors[i]    = ci::Color(v.color[0], v.color[1], v.color[2]);
   }
 
-  return split_text;
-}
-
+  mesh.appendPositions(positions.data(), num);
+  mesh.appendNormals(normals.data(), num);
+  mesh.appendColors(colors.data(), num);
+  mesh.appendIndices(src.indices.data(), src.indices.size());
 
-// ファイルから読み込んでstringstreamにする
-std::istringstream createStringStream(const std::string& path)
-{
-  auto str = ci::loadString(Asset::load(path));
-  return std::istringstream(str);
+  return mesh;
 }
 
-
-ci::TriMesh load(const std::string& path, bool do_optimize)
+// TriMesh→解析結果と同じ形式
+Mesh fromTriMesh(const ci::TriMesh& mesh)
 {
-  auto iss = createStringStream(path);
-
-  // 頂点カラーを含むTriMeshを準備
-  ci::TriMesh mesh(ci::TriMesh::Format().positions().normals().colors());
-
-  int vertex_num = 0;
-  int face_num = 0;
+  const auto* pos    = mesh.getPositions<3>();
+  const auto* color  = mesh.getColors<3>();
+  const auto& normal = mesh.getNormals();
 
-  // ヘッダ解析
-  while (!iss.eof())
+  Mesh dst;
+  dst.vertices.resize(mesh.getNumVertices());
+  for (size_t i = 0; i < dst.vertices.size(); ++i)
   {
-    // １行読み込む
-    std::string line_buffer;
-    std::getline(iss, line_buffer);
-
-    auto split_text = split(line_buffer);
-    if (split_text[0] == "element" && split_text[1] == "vertex")
-    {
-      // 頂点数
-      vertex_num = std::stoi(split_text[2]);
-    }
-    else if (split_text[0] == "element" && split_text[1] == "face")
-    {
-      // ポリゴン数
-      face_num = std::stoi(split_text[2]);
-    }
-    else if (split_text[0] == "end_header")
-    {
-      // ヘッダ終了
-      break;
-    }
+    auto& v = dst.vertices[i];
+    std::memcpy(v.position, &pos[i],    sizeof(v.position));
+    std::memcpy(v.normal,   &normal[i], sizeof(v.normal));
+    std::memcpy(v.color,    &color[i],  sizeof(v.color));
   }
+  dst.indices = mesh.getIndices();
 
-  assert((vertex_num != 0) && (face_num != 0));
-  
-  for (int i = 0; i < vertex_num; ++i)
-  {
-    std::string line_buffer;
-    std::getline(iss, line_buffer);
-    auto split_text = split(line_buffer);
+  return dst;
+}
 
-    glm::vec3 p(std::stof(split_text[0]), std::stof(split_text[1]), std::stof(split_text[2]));
-    mesh.appendPosition(p);
 
-    ci::Color c(std::stof(split_text[3]) / 255.0f, std::stof(split_text[4]) / 255.0f, std::stof(split_text[5]) / 255.0f);
-    mesh.appendColorRgb(c);
-  }
-  
-  for (int i = 0; i < face_num; ++i)
-  {
-    std::string line_buffer;
-    std::getline(iss, line_buffer);
-    auto split_text = split(line_buffer);
-
-    switch (std::stoi(split_text[0]))
-    {
-    case 3:
-      {
-        uint32_t v0 = uint32_t(std::stoul(split_text[1]));
-        uint32_t v1 = uint32_t(std::stoul(split_text[2]));
-        uint32_t v2 = uint32_t(std::stoul(split_text[3]));
-        mesh.appendTriangle(v0, v1, v2);
-      }
-      break;
-
-    case 4:
-      {
-        uint32_t v0 = uint32_t(std::stoul(split_text[1]));
-        uint32_t v1 = uint32_t(std::stoul(split_text[2]));
-        uint32_t v2 = uint32_t(std::stoul(split_text[3]));
-        uint32_t v3 = uint32_t(std::stoul(split_text[4]));
-        mesh.appendTriangle(v0, v1, v2);
-        mesh.appendTriangle(v0, v2, v3);
-      }
-      break;
-    }
-  }
+ci::TriMesh load(const std::string& path, bool do_optimize)
+{
+  // TIPS 読み込んだバッファを直接解析する
+  auto buffer = Asset::load(path)->getBuffer();
 
-  mesh.recalculateNormals();
+  Mesh src;
+  bool result = parse(buffer->getData(), buffer->getSize(), src);
+  assert(result);
+
+  calcNormals(src);
 
   // DOUT << path << '\n'
-  //      << "  face: " << face_num << '\n'
-  //      << "vertex: " << vertex_num << '\n'
+  //      << "vertex: " << src.vertices.size() << '\n'
+  //      << " index: " << src.indices.size() << '\n'
   //      << std::endl;
 
+  auto mesh = toTriMesh(src);
   return do_optimize ? optimize(mesh)
                      : mesh;
 }
@@ -154,52 +107,11 @@ void displaceNormals(ci::TriMesh& mesh)
 
 // 同じ頂点を削除する
 ci::TriMesh optimize(const ci::TriMesh& mesh)
-{ 
-  // 頂点カラーを含むTriMeshを準備
-  ci::TriMesh opt_mesh(ci::TriMesh::Format().positions().normals().colors());
-
-  // 頂点索引変換情報
-  std::map<uint32_t, uint32_t> indices;
-
-  // 全頂点情報を取り出す
-  const auto* pos    = mesh.getPositions<3>();
-  const auto& color  = mesh.getColors<3>();
-  const auto& normal = mesh.getNormals();
-
-  uint32_t vertex_num = uint32_t(mesh.getNumVertices());
-  uint32_t index = 0;
-  for (uint32_t i = 0; i < vertex_num; ++i)
-  {
-    for (uint32_t j = 0; j < i; ++j)
-    {
-      if (pos[j] == pos[i]
-          && color[j] == color[i]
-          && normal[j] == normal[i])
-      {
-        // 同じ頂点が見つかった
-        indices.insert({ i, indices.at(j) });
-        goto NEXT;
-      }
-    }
-
-    // 見つからなかった
-    opt_mesh.appendPosition(pos[i]);
-    opt_mesh.appendColorRgb(color[i]);
-    opt_mesh.appendNormal(normal[i]);
-    indices.insert({ i, index });
-    ++index;
-  NEXT:
-    ;
-  }
+{
+  auto src = fromTriMesh(mesh);
+  weld(src);
 
-  // 再マップ
-  const auto& mesh_indices = mesh.getIndices();
-  std::vector<uint32_t> opt_indices(mesh_indices.size());
-  for (size_t i = 0; i < mesh_indices.size(); ++i)
-  {
-    opt_indices[i] = indices.at(mesh_indices[i]);
-  }
-  opt_mesh.getIndices() = opt_indices;
+  auto opt_mesh = toTriMesh(src);
 
   DOUT << "vtx: " << mesh.getNumVertices()
        << " -> " << opt_mesh.getNumVertices()
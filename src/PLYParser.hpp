@@ -0,0 +1,502 @@
+﻿#pragma once
+
+//
+// PLYの解析
+//   読み込んだバッファをそのまま走査する(行ごとの文字列は作らない)
+//   ascii と binary_little_endian に対応
+//   頂点は x y z と red green blue のみ使い、他の要素や属性は読み飛ばす
+//   NOTICE tools/meshconv からも使うのでCinderに依存しないこと
+//
+
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "MeshFormat.hpp"
+
+
+namespace ngs { namespace PLY {
+
+struct Mesh
+{
+  // 法線は calcNormals で求める
+  std::vector<MeshFormat::Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+
+namespace Parser {
+
+enum Type
+{
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  FLOAT32,
+  FLOAT64,
+
+  UNKNOWN
+};
+
+struct Property
+{
+  std::string name;
+  Type type;
+  // リストの場合は要素数の型
+  Type count_type;
+  bool is_list;
+};
+
+struct Element
+{
+  std::string name;
+  size_t num;
+  std::vector<Property> properties;
+};
+
+
+inline Type toType(const std::string& name) noexcept
+{
+  if (name == "char"   || name == "int8")    return INT8;
+  if (name == "uchar"  || name == "uint8")   return UINT8;
+  if (name == "short"  || name == "int16")   return INT16;
+  if (name == "ushort" || name == "uint16")  return UINT16;
+  if (name == "int"    || name == "int32")   return INT32;
+  if (name == "uint"   || name == "uint32")  return UINT32;
+  if (name == "float"  || name == "float32") return FLOAT32;
+  if (name == "double" || name == "float64") return FLOAT64;
+  return UNKNOWN;
+}
+
+inline size_t typeSize(Type type) noexcept
+{
+  static const size_t tbl[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+  return tbl[type];
+}
+
+
+// 1行ずつ、空白区切りで読む
+class Cursor
+{
+  const char* p_;
+  const char* end_;
+
+
+public:
+  Cursor(const char* p, const char* end) noexcept
+    : p_(p),
+      end_(end)
+  {}
+
+  bool isEnd() const noexcept
+  {
+    return p_ >= end_;
+  }
+
+  size_t remain() const noexcept
+  {
+    return end_ - p_;
+  }
+
+  void skipSpace() noexcept
+  {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) ++p_;
+  }
+
+  void skipLine() noexcept
+  {
+    while (p_ < end_ && *p_ != '\n') ++p_;
+    if (p_ < end_) ++p_;
+  }
+
+  // 行内の次の単語(改行は越えない)
+  std::string word() noexcept
+  {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r')) ++p_;
+    auto* top = p_;
+    while (p_ < end_ && !std::isspace(static_cast<unsigned char>(*p_))) ++p_;
+    return std::string(top, p_);
+  }
+
+  // 10進数の数値
+  double number() noexcept
+  {
+    skipSpace();
+
+    bool negative = false;
+    if (p_ < end_ && (*p_ == '-' || *p_ == '+'))
+    {
+      negative = (*p_ == '-');
+      ++p_;
+    }
+
+    double value = 0.0;
+    while (p_ < end_ && *p_ >= '0' && *p_ <= '9')
+    {
+      value = value * 10.0 + (*p_ - '0');
+      ++p_;
+    }
+    if (p_ < end_ && *p_ == '.')
+    {
+      ++p_;
+      double scale = 0.1;
+      while (p_ < end_ && *p_ >= '0' && *p_ <= '9')
+      {
+        value += (*p_ - '0') * scale;
+        scale *= 0.1;
+        ++p_;
+      }
+    }
+    if (p_ < end_ && (*p_ == 'e' || *p_ == 'E'))
+    {
+      ++p_;
+      int exp_sign = 1;
+      if (p_ < end_ && (*p_ == '-' || *p_ == '+'))
+      {
+        exp_sign = (*p_ == '-') ? -1 : 1;
+        ++p_;
+      }
+      int exp = 0;
+      while (p_ < end_ && *p_ >= '0' && *p_ <= '9')
+      {
+        exp = exp * 10 + (*p_ - '0');
+        ++p_;
+      }
+      value *= std::pow(10.0, exp_sign * exp);
+    }
+
+    return negative ? -value : value;
+  }
+
+  // バイナリ(リトルエンディアン)
+  double binary(Type type) noexcept
+  {
+    auto size = typeSize(type);
+    if (remain() < size)
+    {
+      p_ = end_;
+      return 0.0;
+    }
+
+    double value = 0.0;
+    switch (type)
+    {
+    case INT8:    value = read<int8_t>();   break;
+    case UINT8:   value = read<uint8_t>();  break;
+    case INT16:   value = read<int16_t>();  break;
+    case UINT16:  value = read<uint16_t>(); break;
+    case INT32:   value = read<int32_t>();  break;
+    case UINT32:  value = read<uint32_t>(); break;
+    case FLOAT32: value = read<float>();    break;
+    case FLOAT64: value = read<double>();   break;
+    default:
+      break;
+    }
+    return value;
+  }
+
+
+private:
+  template <typename T>
+  T read() noexcept
+  {
+    T value;
+    // TIPS アラインメントが揃っていないのでmemcpyで読む
+    std::memcpy(&value, p_, sizeof(T));
+    p_ += sizeof(T);
+    return value;
+  }
+};
+
+
+// 戻り値:false 対応していない形式
+inline bool parseHeader(Cursor& cursor, bool& binary, std::vector<Element>& elements) noexcept
+{
+  if (cursor.word() != "ply") return false;
+  cursor.skipLine();
+
+  while (!cursor.isEnd())
+  {
+    auto keyword = cursor.word();
+    if (keyword == "format")
+    {
+      auto format = cursor.word();
+      if (format == "ascii")                     binary = false;
+      else if (format == "binary_little_endian") binary = true;
+      else return false;
+    }
+    else if (keyword == "element")
+    {
+      auto name = cursor.word();
+      auto num  = cursor.word();
+      elements.push_back({ name, size_t(std::strtoul(num.c_str(), nullptr, 10)), { } });
+    }
+    else if (keyword == "property")
+    {
+      if (elements.empty()) return false;
+
+      auto type = cursor.word();
+      if (type == "list")
+      {
+        auto count_type = toType(cursor.word());
+        auto value_type = toType(cursor.word());
+        elements.back().properties.push_back({ cursor.word(), value_type, count_type, true });
+      }
+      else
+      {
+        elements.back().properties.push_back({ cursor.word(), toType(type), UNKNOWN, false });
+      }
+
+      const auto& p = elements.back().properties.back();
+      if (p.type == UNKNOWN || (p.is_list && p.count_type == UNKNOWN)) return false;
+    }
+    else if (keyword == "end_header")
+    {
+      cursor.skipLine();
+      return true;
+    }
+
+    cursor.skipLine();
+  }
+
+  return false;
+}
+
+}
+
+
+// 解析
+//   戻り値:false 壊れているか対応していない形式
+inline bool parse(const void* data, size_t size, Mesh& mesh) noexcept
+{
+  using namespace Parser;
+
+  const auto* top = static_cast<const char*>(data);
+  Cursor cursor(top, top + size);
+
+  bool binary = false;
+  std::vector<Element> elements;
+  if (!parseHeader(cursor, binary, elements)) return false;
+
+  auto read = [&cursor, binary](Type type) noexcept
+              {
+                return binary ? cursor.binary(type)
+                              : cursor.number();
+              };
+
+  mesh.vertices.clear();
+  mesh.indices.clear();
+
+  for (const auto& element : elements)
+  {
+    if (element.name == "vertex")
+    {
+      // 属性の並び→頂点データの格納先
+      std::vector<float*> dst(element.properties.size());
+      MeshFormat::Vertex v{ };
+      for (size_t i = 0; i < element.properties.size(); ++i)
+      {
+        const auto& name = element.properties[i].name;
+        if (name == "x")     dst[i] = &v.position[0];
+        if (name == "y")     dst[i] = &v.position[1];
+        if (name == "z")     dst[i] = &v.position[2];
+        if (name == "red")   dst[i] = &v.color[0];
+        if (name == "green") dst[i] = &v.color[1];
+        if (name == "blue")  dst[i] = &v.color[2];
+      }
+
+      mesh.vertices.reserve(element.num);
+      for (size_t n = 0; n < element.num; ++n)
+      {
+        for (size_t i = 0; i < element.properties.size(); ++i)
+        {
+          const auto& p = element.properties[i];
+          if (p.is_list)
+          {
+            auto num = size_t(read(p.count_type));
+            for (size_t j = 0; j < num; ++j) read(p.type);
+            continue;
+          }
+
+          auto value = read(p.type);
+          if (!dst[i]) continue;
+
+          // 8bitの色は0〜1へ
+          bool is_color = (dst[i] >= &v.color[0]) && (dst[i] <= &v.color[2]);
+          *dst[i] = (is_color && p.type == UINT8) ? float(value / 255.0)
+                                                  : float(value);
+        }
+        mesh.vertices.push_back(v);
+      }
+    }
+    else if (element.name == "face")
+    {
+      // 3角形以上は扇状に分割
+      mesh.indices.reserve(element.num * 6);
+      std::vector<uint32_t> face;
+      for (size_t n = 0; n < element.num; ++n)
+      {
+        for (const auto& p : element.properties)
+        {
+          if (!p.is_list)
+          {
+            read(p.type);
+            continue;
+          }
+
+          face.resize(size_t(read(p.count_type)));
+          for (auto& index : face)
+          {
+            index = uint32_t(read(p.type));
+          }
+          if (p.name != "vertex_index" && p.name != "vertex_indices") continue;
+
+          for (size_t i = 2; i < face.size(); ++i)
+          {
+            mesh.indices.push_back(face[0]);
+            mesh.indices.push_back(face[i - 1]);
+            mesh.indices.push_back(face[i]);
+          }
+        }
+      }
+    }
+    else
+    {
+      // 他の要素は読み飛ばす
+      for (size_t n = 0; n < element.num; ++n)
+      {
+        for (const auto& p : element.properties)
+        {
+          auto num = p.is_list ? size_t(read(p.count_type)) : 1;
+          for (size_t j = 0; j < num; ++j) read(p.type);
+        }
+      }
+    }
+  }
+
+  if (mesh.vertices.empty() || mesh.indices.empty()) return false;
+  for (auto index : mesh.indices)
+  {
+    if (index >= mesh.vertices.size()) return false;
+  }
+
+  return true;
+}
+
+
+// 面法線を頂点ごとに平均する(TriMesh::recalculateNormalsと同じ)
+inline void calcNormals(Mesh& mesh) noexcept
+{
+  auto normalize = [](float* v) noexcept
+                   {
+                     float l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+                     if (l == 0.0f) return;
+
+                     v[0] /= l;
+                     v[1] /= l;
+                     v[2] /= l;
+                   };
+
+  for (auto& v : mesh.vertices)
+  {
+    v.normal[0] = v.normal[1] = v.normal[2] = 0.0f;
+  }
+
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    const auto* p0 = mesh.vertices[mesh.indices[i + 0]].position;
+    const auto* p1 = mesh.vertices[mesh.indices[i + 1]].position;
+    const auto* p2 = mesh.vertices[mesh.indices[i + 2]].position;
+
+    float e0[] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e1[] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    float n[] = {
+      e0[1] * e1[2] - e0[2] * e1[1],
+      e0[2] * e1[0] - e0[0] * e1[2],
+      e0[0] * e1[1] - e0[1] * e1[0]
+    };
+    normalize(n);
+
+    for (int j = 0; j < 3; ++j)
+    {
+      auto* dst = mesh.vertices[mesh.indices[i + j]].normal;
+      dst[0] += n[0];
+      dst[1] += n[1];
+      dst[2] += n[2];
+    }
+  }
+
+  for (auto& v : mesh.vertices)
+  {
+    normalize(v.normal);
+  }
+}
+
+
+// 位置・法線・色が全て同じ頂点をまとめる
+//   ハッシュで探すので頂点数に比例した時間で終わる
+inline void weld(Mesh& mesh) noexcept
+{
+  using Vertex = MeshFormat::Vertex;
+
+  struct Hash
+  {
+    size_t operator()(const Vertex& v) const noexcept
+    {
+      // FNV-1a
+      const auto* p = reinterpret_cast<const uint8_t*>(&v);
+      uint32_t hash = 2166136261u;
+      for (size_t i = 0; i < sizeof(Vertex); ++i)
+      {
+        hash = (hash ^ p[i]) * 16777619u;
+      }
+      return hash;
+    }
+  };
+
+  struct Equal
+  {
+    bool operator()(const Vertex& a, const Vertex& b) const noexcept
+    {
+      return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+  };
+
+  std::unordered_map<Vertex, uint32_t, Hash, Equal> table;
+  table.reserve(mesh.vertices.size());
+
+  std::vector<Vertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+  std::vector<uint32_t> remap(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.vertices.size(); ++i)
+  {
+    auto& v = mesh.vertices[i];
+    // TIPS -0.0と0.0をバイト列で区別しないように揃える
+    for (auto* f : { v.position, v.normal, v.color })
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        f[j] += 0.0f;
+      }
+    }
+
+    auto result = table.insert({ v, uint32_t(vertices.size()) });
+    if (result.second) vertices.push_back(v);
+    remap[i] = result.first->second;
+  }
+
+  for (auto& index : mesh.indices)
+  {
+    index = remap[index];
+  }
+  mesh.vertices.swap(vertices);
+}
+
+} }
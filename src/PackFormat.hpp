@@ -0,0 +1,145 @@
+﻿#pragma once
+
+//
+// アセットのパックファイル形式(v3)
+//   各データはページ境界に揃えて置くので、マップした領域をそのまま使える
+//   データごとに圧縮方法とCRC32を持つ
+//   NOTICE tools/main.cpp からも使うのでCinderに依存しないこと
+//
+//   Header
+//   Entry × entry_num  名前順
+//   char  × names_size 名前を連結したもの
+//   (ALIGNMENT境界から)データ
+//
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+
+namespace ngs { namespace PackFormat {
+
+enum : uint32_t
+{
+  VERSION   = 3,
+  ALIGNMENT = 4096,
+};
+
+// 圧縮方法
+enum Method : uint32_t
+{
+  STORE,
+  ZLIB,
+};
+
+constexpr char MAGIC[4] = { 'N', 'G', 'S', 'P' };
+
+
+struct Header
+{
+  char     magic[4];
+  uint32_t version;
+  uint64_t entry_num;
+  uint64_t names_size;
+};
+
+struct Entry
+{
+  // ファイル先頭からの位置
+  uint64_t offset;
+  // 格納されているサイズ
+  uint64_t size;
+  // 展開後のサイズ
+  uint64_t original_size;
+  // 元ファイルと圧縮方法のハッシュ(tools/main.cpp で差分の判定に使う)
+  uint64_t source_hash;
+  // 名前の位置(連結した名前の先頭から)
+  uint32_t name_offset;
+  uint32_t name_size;
+  uint32_t method;
+  // 格納されているデータのCRC32
+  uint32_t crc32;
+};
+
+static_assert(sizeof(Header) == 24, "PackFormat::Header");
+static_assert(sizeof(Entry)  == 48, "PackFormat::Entry");
+
+
+inline uint64_t align(uint64_t offset) noexcept
+{
+  return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// ヘッダから名前までのサイズ
+inline uint64_t calcIndexSize(uint64_t entry_num, uint64_t names_size) noexcept
+{
+  return sizeof(Header) + sizeof(Entry) * entry_num + names_size;
+}
+
+inline const Entry* getEntries(const Header& header) noexcept
+{
+  return reinterpret_cast<const Entry*>(&header + 1);
+}
+
+inline const char* getNames(const Header& header) noexcept
+{
+  return reinterpret_cast<const char*>(getEntries(header) + header.entry_num);
+}
+
+// 全てのEntryがファイルに収まっているか調べる
+// 戻り値:nullptr 形式が違う
+inline const Header* getHeader(const void* data, size_t size) noexcept
+{
+  if (size < sizeof(Header)) return nullptr;
+
+  const auto* header = static_cast<const Header*>(data);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC))
+      || header->version != VERSION
+      || header->entry_num > (size - sizeof(Header)) / sizeof(Entry)
+      || header->names_size > size
+      || calcIndexSize(header->entry_num, header->names_size) > size)
+  {
+    return nullptr;
+  }
+
+  const auto* entries = getEntries(*header);
+  for (uint64_t i = 0; i < header->entry_num; ++i)
+  {
+    const auto& e = entries[i];
+    if ((uint64_t(e.name_offset) + e.name_size) > header->names_size
+        || e.offset > size
+        || e.size > (size - e.offset)
+        || e.method > ZLIB)
+    {
+      return nullptr;
+    }
+  }
+
+  return header;
+}
+
+// 名前で探す
+// 戻り値:nullptr 含まれていない
+inline const Entry* find(const Header& header, const char* name, size_t name_size) noexcept
+{
+  const auto* names = getNames(header);
+  const auto* begin = getEntries(header);
+  const auto* end   = begin + header.entry_num;
+
+  auto it = std::lower_bound(begin, end, name,
+                             [names, name_size](const Entry& e, const char* name) noexcept
+                             {
+                               const auto* p = names + e.name_offset;
+                               return std::lexicographical_compare(p, p + e.name_size, name, name + name_size);
+                             });
+  if (it == end
+      || it->name_size != name_size
+      || std::memcmp(names + it->name_offset, name, name_size))
+  {
+    return nullptr;
+  }
+
+  return it;
+}
+
+} }
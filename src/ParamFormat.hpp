@@ -0,0 +1,185 @@
+﻿#pragma once
+
+//
+// パラメーターのバイナリ形式(.bundle)
+//   params.jsonや画面ごとのJSONを事前に解析して一つにまとめたもの(tools/paramc.cpp)
+//   実行時に文字列を解析しなくて済む
+//   NOTICE tools/paramc からも使うのでCinderに依存しないこと
+//
+//   Header
+//   File × file_num  名前順
+//   Node × node_num  子供は連続して並んでいる(オブジェクトはキーの順)
+//   char × strings_size キーと文字列(それぞれ'\0'で終わる)
+//
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+
+namespace ngs { namespace ParamFormat {
+
+enum : uint32_t
+{
+  VERSION = 1,
+};
+
+enum Type : uint32_t
+{
+  OBJECT,
+  ARRAY,
+  BOOL,
+  INT,
+  UINT,
+  DOUBLE,
+  STRING,
+};
+
+constexpr char MAGIC[4] = { 'N', 'G', 'S', 'B' };
+
+
+struct Header
+{
+  char     magic[4];
+  uint32_t version;
+  uint32_t file_num;
+  uint32_t node_num;
+  uint32_t strings_size;
+  uint32_t reserved;
+};
+
+struct File
+{
+  // 名前の位置
+  uint32_t name;
+  // 一番上のノード
+  uint32_t root;
+};
+
+struct Node
+{
+  uint32_t type;
+  // キーの位置(配列の要素は使わない)
+  uint32_t key;
+
+  union
+  {
+    // BOOLもこれ
+    int64_t  i;
+    uint64_t u;
+    double   d;
+    // STRING
+    uint32_t string;
+    // OBJECT, ARRAY
+    struct
+    {
+      uint32_t first;
+      uint32_t num;
+    } children;
+  } value;
+};
+
+static_assert(sizeof(Header) == 24, "ParamFormat::Header");
+static_assert(sizeof(File)   ==  8, "ParamFormat::File");
+static_assert(sizeof(Node)   == 16, "ParamFormat::Node");
+
+
+inline size_t calcSize(const Header& header) noexcept
+{
+  return sizeof(Header)
+       + sizeof(File) * size_t(header.file_num)
+       + sizeof(Node) * size_t(header.node_num)
+       + header.strings_size;
+}
+
+inline const File* getFiles(const Header& header) noexcept
+{
+  return reinterpret_cast<const File*>(&header + 1);
+}
+
+inline const Node* getNodes(const Header& header) noexcept
+{
+  return reinterpret_cast<const Node*>(getFiles(header) + header.file_num);
+}
+
+inline const char* getString(const Header& header, uint32_t offset) noexcept
+{
+  return reinterpret_cast<const char*>(getNodes(header) + header.node_num) + offset;
+}
+
+// 戻り値:nullptr 形式が違う
+// NOTICE 全ての位置が範囲内かどうかも調べる
+inline const Header* getHeader(const void* data, size_t size) noexcept
+{
+  if (size < sizeof(Header)) return nullptr;
+
+  const auto* header = static_cast<const Header*>(data);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC))
+      || header->version != VERSION
+      || size < calcSize(*header)
+      || header->strings_size == 0
+      || getString(*header, header->strings_size - 1)[0] != '\0')
+  {
+    return nullptr;
+  }
+
+  const auto* files = getFiles(*header);
+  for (uint32_t i = 0; i < header->file_num; ++i)
+  {
+    if (files[i].name >= header->strings_size || files[i].root >= header->node_num) return nullptr;
+  }
+
+  const auto* nodes = getNodes(*header);
+  for (uint32_t i = 0; i < header->node_num; ++i)
+  {
+    const auto& node = nodes[i];
+    if (node.key >= header->strings_size) return nullptr;
+
+    switch (node.type)
+    {
+    case OBJECT:
+    case ARRAY:
+      // TIPS 子供は必ず親より後ろにあるので、辿っても循環しない
+      if ((node.value.children.num && node.value.children.first <= i)
+          || node.value.children.first > header->node_num
+          || node.value.children.num > (header->node_num - node.value.children.first))
+      {
+        return nullptr;
+      }
+      break;
+
+    case STRING:
+      if (node.value.string >= header->strings_size) return nullptr;
+      break;
+
+    case BOOL:
+    case INT:
+    case UINT:
+    case DOUBLE:
+      break;
+
+    default:
+      return nullptr;
+    }
+  }
+
+  return header;
+}
+
+// ファイル名から一番上のノードを探す
+// 戻り値:nullptr 含まれていない
+inline const Node* find(const Header& header, const char* name) noexcept
+{
+  const auto* files = getFiles(header);
+  const auto* end   = files + header.file_num;
+  auto it = std::lower_bound(files, end, name,
+                             [&header](const File& file, const char* n) noexcept
+                             {
+                               return std::strcmp(getString(header, file.name), n) < 0;
+                             });
+  if (it == end || std::strcmp(getString(header, it->name), name)) return nullptr;
+
+  return getNodes(header) + it->root;
+}
+
+} }
@@ -2,30 +2,126 @@
 
 //
 // アプリ内パラメーター
+//   USE_PARAM_BUNDLEの時は事前に変換したもの(params.bundle, tools/paramc.cpp)から作る
+//   それ以外はJSONを直接読む(DEBUGではKEY_rで読み直せる)
 //
 
 #include <cinder/Json.h>
 #include "Asset.hpp"
-#include "TextCodec.hpp"
+#include "ParamFormat.hpp"
 
 
 namespace ngs { namespace Params {
 
+#if defined (USE_PARAM_BUNDLE)
+
+namespace {
+
+struct Bundle
+{
+  ci::BufferRef buffer;
+  const ParamFormat::Header* header = nullptr;
+
+  Bundle() noexcept
+  {
+    try
+    {
+      buffer = Asset::load("params.bundle")->getBuffer();
+      header = ParamFormat::getHeader(buffer->getData(), buffer->getSize());
+    }
+    catch (ci::Exception& ex)
+    {
+      DOUT << ex.what() << std::endl;
+    }
+
+    if (!header) DOUT << "No params bundle." << std::endl;
+  }
+};
+
+// TIPS 最初に使った時に読み込み、終了まで保持
+const Bundle& getBundle() noexcept
+{
+  static Bundle bundle;
+  return bundle;
+}
+
+// 子供をJsonTreeに追加する
+// TIPS 追加してから中身を作るので、JsonTreeの複製が起きない
+void addChildren(const ParamFormat::Header& header, const ParamFormat::Node& node, ci::JsonTree& json) noexcept
+{
+  const auto* children = ParamFormat::getNodes(header) + node.value.children.first;
+  for (uint32_t i = 0; i < node.value.children.num; ++i)
+  {
+    const auto& child = children[i];
+    std::string key = (node.type == ParamFormat::OBJECT) ? ParamFormat::getString(header, child.key) : "";
+
+    switch (child.type)
+    {
+    case ParamFormat::OBJECT:
+      json.pushBack(ci::JsonTree::makeObject(key));
+      addChildren(header, child, json.getChildren().back());
+      break;
+
+    case ParamFormat::ARRAY:
+      json.pushBack(ci::JsonTree::makeArray(key));
+      addChildren(header, child, json.getChildren().back());
+      break;
+
+    case ParamFormat::BOOL:
+      json.pushBack(ci::JsonTree(key, child.value.i != 0));
+      break;
+
+    case ParamFormat::INT:
+      json.pushBack(ci::JsonTree(key, child.value.i));
+      break;
+
+    case ParamFormat::UINT:
+      json.pushBack(ci::JsonTree(key, child.value.u));
+      break;
+
+    case ParamFormat::DOUBLE:
+      json.pushBack(ci::JsonTree(key, child.value.d));
+      break;
+
+    case ParamFormat::STRING:
+      json.pushBack(ci::JsonTree(key, std::string(ParamFormat::getString(header, child.value.string))));
+      break;
+    }
+  }
+}
+
+// 戻り値:false 含まれていない
+bool loadBundle(const std::string& path, ci::JsonTree& json) noexcept
+{
+  const auto* header = getBundle().header;
+  if (!header) return false;
+
+  const auto* root = ParamFormat::find(*header, path.c_str());
+  if (!root) return false;
+
+  json = (root->type == ParamFormat::ARRAY) ? ci::JsonTree::makeArray() : ci::JsonTree::makeObject();
+  addChildren(*header, *root, json);
+  return true;
+}
+
+}
+
+#endif
+
 ci::JsonTree load(const std::string& path)
 {
+#if defined (USE_PARAM_BUNDLE)
+  ci::JsonTree json;
+  if (loadBundle(path, json)) return json;
+
+  DOUT << "Not in params bundle: " << path << std::endl;
+#endif
   return ci::JsonTree(Asset::load(path));
 }
 
 ci::JsonTree loadParams()
 {
-#if defined (OBFUSCATION_PARAMS)
-  // 難読化されたファイル→JSON
-  auto text = TextCodec::load(ci::app::getAssetPath("params.data").string());
-  return ci::JsonTree(text);
-#else
-  // Jsonファイルをそのまま読む
   return load("params.json");
-#endif
 }
 
 } }
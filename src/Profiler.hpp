@@ -0,0 +1,246 @@
+﻿#pragma once
+
+//
+// 処理時間計測
+//   PROFILE_SCOPE("名前") でスコープを抜けるまでの時間を記録する
+//   NGS_PROFILE未定義時は何も生成しない
+//   実行時も無効ならフラグを見るだけ
+//   NOTICE メインスレッド専用
+//
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <boost/noncopyable.hpp>
+#include <cinder/Filesystem.h>
+
+
+namespace ngs { namespace Profiler {
+
+using Clock = std::chrono::steady_clock;
+
+// 1スコープ分の記録
+struct Record
+{
+  const char* name;
+  u_int depth;
+  // フレーム開始からの時間(ms)
+  double begin;
+  double duration;
+};
+
+
+void enable(bool enable = true) noexcept;
+bool isEnabled() noexcept;
+
+void beginFrame() noexcept;
+void endFrame() noexcept;
+
+// 直前のフレームの記録
+const std::vector<Record>& lastFrame() noexcept;
+double lastFrameTime() noexcept;
+
+// CSVへの書き出し
+//   記録は一定量溜まるごとにファイルへ書き出す
+void startRecording(const ci::fs::path& path) noexcept;
+void stopRecording() noexcept;
+bool isRecording() noexcept;
+
+
+// 内部利用
+extern bool enabled;
+size_t beginScope(const char* name) noexcept;
+void endScope(size_t index, Clock::time_point begin) noexcept;
+
+
+class Scope
+  : private boost::noncopyable
+{
+  size_t index_;
+  Clock::time_point begin_;
+  bool active_;
+
+
+public:
+  explicit Scope(const char* name) noexcept
+    : active_(enabled)
+  {
+    if (!active_) return;
+
+    index_ = beginScope(name);
+    begin_ = Clock::now();
+  }
+
+  ~Scope()
+  {
+    if (!active_) return;
+
+    endScope(index_, begin_);
+  }
+};
+
+
+#if defined (NGS_PROFILER_IMPLEMENTATION)
+
+bool enabled = false;
+
+Clock::time_point frame_begin;
+u_int depth = 0;
+
+std::vector<Record> records;
+std::vector<Record> last_records;
+double last_frame_time = 0.0;
+
+// CSV用
+bool recording = false;
+u_int frame_count = 0;
+std::vector<std::pair<u_int, Record>> csv_records;
+std::ofstream csv_file;
+ci::fs::path csv_path;
+
+// この数を超えたらファイルへ書き出す
+constexpr size_t CSV_FLUSH_RECORDS = 4096;
+
+
+double toMsec(Clock::duration d) noexcept
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void flushRecords() noexcept
+{
+  for (const auto& it : csv_records)
+  {
+    const auto& r = it.second;
+    csv_file << it.first << ','
+             << r.name << ','
+             << r.depth << ','
+             << r.begin << ','
+             << r.duration << '\n';
+  }
+  csv_records.clear();
+}
+
+
+void enable(bool enable) noexcept
+{
+  enabled = enable;
+  depth   = 0;
+  records.clear();
+  if (!enable) last_records.clear();
+}
+
+bool isEnabled() noexcept
+{
+  return enabled;
+}
+
+
+void beginFrame() noexcept
+{
+  if (!enabled) return;
+
+  records.clear();
+  depth       = 0;
+  frame_begin = Clock::now();
+}
+
+void endFrame() noexcept
+{
+  if (!enabled) return;
+
+  last_frame_time = toMsec(Clock::now() - frame_begin);
+  last_records.swap(records);
+
+  if (recording)
+  {
+    for (const auto& r : last_records)
+    {
+      csv_records.push_back({ frame_count, r });
+    }
+    csv_records.push_back({ frame_count, { "frame", 0, 0.0, last_frame_time } });
+    ++frame_count;
+
+    if (csv_records.size() >= CSV_FLUSH_RECORDS) flushRecords();
+  }
+}
+
+
+const std::vector<Record>& lastFrame() noexcept
+{
+  return last_records;
+}
+
+double lastFrameTime() noexcept
+{
+  return last_frame_time;
+}
+
+
+void startRecording(const ci::fs::path& path) noexcept
+{
+  if (recording) return;
+
+  csv_file.open(path.string());
+  if (!csv_file)
+  {
+    DOUT << "Profiler: can't open " << path << std::endl;
+    csv_file.clear();
+    return;
+  }
+  csv_file << "frame,name,depth,begin_ms,duration_ms\n";
+
+  recording   = true;
+  frame_count = 0;
+  csv_path    = path;
+  csv_records.clear();
+  csv_records.reserve(CSV_FLUSH_RECORDS);
+}
+
+void stopRecording() noexcept
+{
+  if (!recording) return;
+  recording = false;
+
+  flushRecords();
+  csv_file.close();
+  csv_file.clear();
+
+  DOUT << "Profiler: " << csv_path << std::endl;
+}
+
+bool isRecording() noexcept
+{
+  return recording;
+}
+
+
+size_t beginScope(const char* name) noexcept
+{
+  records.push_back({ name, depth, toMsec(Clock::now() - frame_begin), 0.0 });
+  ++depth;
+  return records.size() - 1;
+}
+
+void endScope(size_t index, Clock::time_point begin) noexcept
+{
+  // TIPS フレームの途中で有効・無効が切り替わった場合は記録が無い
+  if (index >= records.size()) return;
+
+  --depth;
+  records[index].duration = toMsec(Clock::now() - begin);
+}
+
+#endif
+
+} }
+
+
+#if defined (NGS_PROFILE)
+#define PROFILE_SCOPE_CAT2(a, b) a ## b
+#define PROFILE_SCOPE_CAT(a, b)  PROFILE_SCOPE_CAT2(a, b)
+#define PROFILE_SCOPE(name) ngs::Profiler::Scope PROFILE_SCOPE_CAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
@@ -22,12 +22,11 @@ public:
 
 
   Purchase(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-           const Condition& condition)
+           UI::CanvasCache& canvas_cache, const Condition& condition)
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("purchase.canvas")),
-              Params::load(params.getValueForKey<std::string>("purchase.tweens")))
+              canvas_cache.get(params, "purchase"))
   {
     startTimelineSound(event_, params, "purchase.se");
 
@@ -9,6 +9,7 @@
 #include "UICanvas.hpp"
 #include "TweenUtil.hpp"
 #include "ConvertRank.hpp" 
+#include "ArchiveData.hpp"
 #include "UISupport.hpp"
 #include "Share.h"
 #include "Capture.h"
@@ -21,15 +22,14 @@ class Ranking
 {
 public:
   Ranking(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-          const Arguments& args) noexcept
+          UI::CanvasCache& canvas_cache, const Arguments& args) noexcept
     : event_(event),
       ranking_text_(Json::getArray<std::string>(params["result.ranking"])),
       ranking_records_(params.getValueForKey<u_int>("game.ranking_records")),
       share_text_(params.getValueForKey<std::string>("ranking.share")),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("ranking.canvas")),
-              Params::load(params.getValueForKey<std::string>("ranking.tweens")))
+              canvas_cache.get(params, "ranking"))
   {
     startTimelineSound(event_, params, "ranking.se");
 
@@ -215,7 +215,7 @@ public:
     }
     
     // NOTICE Title→Rankingの時は記録があるが、Result→Rankingの場合は記録が無い
-    applyRankings(boost::any_cast<const ci::JsonTree&>(args.at("games")));
+    applyRankings(boost::any_cast<const std::vector<ArchiveData::Game>&>(args.at("games")));
 
     canvas_.startCommonTween("root",
                              rank_in_ ? "in-from-left"
@@ -245,28 +245,26 @@ private:
   }
 
 
-  void applyRankings(const ci::JsonTree& rankings) noexcept
+  void applyRankings(const std::vector<ArchiveData::Game>& rankings) noexcept
   {
     // NOTICE ソート済みの配列である事
-    size_t num = std::min(rankings.getNumChildren(), ranking_records_);
+    size_t num = std::min(rankings.size(), ranking_records_);
     for (size_t i = 0; i < num; ++i)
     {
-      const auto& json = rankings[i];
+      const auto& game = rankings[i];
       {
         char id[16];
         std::sprintf(id, "%d", int(i + 1));
-        auto score = json.getValueForKey<u_int>("score");
-        canvas_.setWidgetText(id, std::to_string(score));
+        canvas_.setWidgetText(id, std::to_string(game.score));
       }
       {
         char id[16];
         std::sprintf(id, "r%d", int(i + 1));
-        auto rank = json.getValueForKey<u_int>("rank");
-        convertRankToText(rank, canvas_, id, ranking_text_);
+        convertRankToText(game.rank, canvas_, id, ranking_text_);
       }
     }
 
-    if (ranking_ < rankings.getNumChildren())
+    if (ranking_ < rankings.size())
     {
       applyRankingEffect(ranking_);
     }
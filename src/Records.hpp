@@ -50,12 +50,11 @@ public:
 
 
   Records(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-          const Detail& detail) noexcept
+          UI::CanvasCache& canvas_cache, const Detail& detail) noexcept
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("records.canvas")),
-              Params::load(params.getValueForKey<std::string>("records.tweens")))
+              canvas_cache.get(params, "records"))
   {
     startTimelineSound(event_, params, "records.se");
 
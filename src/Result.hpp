@@ -23,7 +23,7 @@ class Result
 
 public:
   Result(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-         const Arguments& args) noexcept
+         UI::CanvasCache& canvas_cache, const Arguments& args) noexcept
     : event_(event),
       ranking_text_(Json::getArray<std::string>(params["result.ranking"])),
       effect_speed_(Json::getVec<glm::vec3>(params["result.effect_speed"])),
@@ -31,8 +31,7 @@ public:
       timeline_(ci::Timeline::create()),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("result.canvas")),
-              Params::load(params.getValueForKey<std::string>("result.tweens")))
+              canvas_cache.get(params, "result"))
   {
     startTimelineSound(event_, params, "result.se");
 
@@ -24,12 +24,11 @@ public:
 
 
   Settings(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-           const Condition& condition) noexcept
+           UI::CanvasCache& canvas_cache, const Condition& condition) noexcept
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("settings.canvas")),
-              Params::load(params.getValueForKey<std::string>("settings.tweens"))),
+              canvas_cache.get(params, "settings")),
       sound_enable_(params.getValueForKey<std::string>("settings.sound_enable")),
       sound_disable_(params.getValueForKey<std::string>("settings.sound_disable"))
   {
@@ -32,6 +32,12 @@ class Sound
     return active_;
   }
 
+  // TIPS そのフレームに要求された遅延0の音も同じフレームで鳴らす
+  Phase phase() const noexcept override
+  {
+    return VIEW;
+  }
+
 
   template <typename T>
   void stopAll(const T& array)
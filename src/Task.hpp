@@ -15,10 +15,30 @@ namespace ngs {
 struct Task
   : private boost::noncopyable
 {
+  // 更新順序(入力→ロジック→表示)
+  enum Phase
+  {
+    INPUT,
+    LOGIC,
+    VIEW,
+
+    PHASE_NUM
+  };
+
+
   virtual ~Task() = default;
 
   // 戻り値:false タスク終了
   virtual bool update(double current_time, double delta_time) noexcept = 0;
+
+  virtual Phase phase() const noexcept
+  {
+    return LOGIC;
+  }
+
+  // 終了時に休止させる(再利用するタスクのみ呼ばれる)
+  //   再開は resume(生成時と同じ引数) で行う
+  virtual void suspend() noexcept {}
 };
 
 }
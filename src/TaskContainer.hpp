@@ -2,10 +2,24 @@
 
 //
 // タスクコンテナ
+//   型ごとのプールに生成するので、タスクのアドレスは破棄まで不変
+//   更新はTask::Phaseの順(入力→ロジック→表示)
+//   reusableを宣言した型は終了時に破棄せず休止させ、次のpushで再開する
+//
+//   struct Foo : public Task
+//   {
+//     static constexpr bool reusable = true;
+//     void resume(生成時と同じ引数);
+//   };
 //
 
 #include "Task.hpp"
-#include <list>
+#include <array>
+#include <vector>
+#include <map>
+#include <memory>
+#include <typeindex>
+#include <type_traits>
 #include <algorithm>
 
 
@@ -14,46 +28,273 @@ namespace ngs {
 class TaskContainer
   : private boost::noncopyable
 {
-  std::list<std::unique_ptr<Task>> tasks_;
+  // 型を消したプール
+  struct PoolBase
+    : private boost::noncopyable
+  {
+    virtual ~PoolBase() = default;
+
+    virtual void destroy(Task* task) noexcept = 0;
+    virtual bool isReusable() const noexcept = 0;
+
+    // 休止中のインスタンス
+    Task* suspended = nullptr;
+  };
+
+  // 再利用可能な型か判定
+  template <typename T, typename = void>
+  struct Reusable
+    : std::false_type
+  {};
+
+  template <typename T>
+  struct Reusable<T, decltype(void(T::reusable))>
+    : std::integral_constant<bool, T::reusable>
+  {};
+
+
+  // 型ごとの固定長ブロック
+  // TIPS ブロックを追加しても既存の領域は移動しない
+  template <typename T>
+  class Pool
+    : public PoolBase
+  {
+    using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    struct Chunk
+    {
+      explicit Chunk(size_t num)
+        : storage(new Storage[num]),
+          used(num, false)
+      {}
+
+      std::unique_ptr<Storage[]> storage;
+      std::vector<bool> used;
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t chunk_size_;
+
+
+  public:
+    explicit Pool(size_t chunk_size) noexcept
+      : chunk_size_(std::max<size_t>(chunk_size, 1))
+    {
+      chunks_.emplace_back(chunk_size_);
+    }
+
+    ~Pool() = default;
+
+
+    template <typename... Args>
+    T* create(Args&&... args) noexcept
+    {
+      for (auto& chunk : chunks_)
+      {
+        for (size_t i = 0; i < chunk.used.size(); ++i)
+        {
+          if (chunk.used[i]) continue;
+
+          chunk.used[i] = true;
+          return new (&chunk.storage[i]) T(std::forward<Args>(args)...);
+        }
+      }
+
+      // 空きが無いのでブロックを追加
+      chunks_.emplace_back(chunk_size_);
+      auto& chunk = chunks_.back();
+      chunk.used[0] = true;
+      return new (&chunk.storage[0]) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(Task* task) noexcept override
+    {
+      auto* p = static_cast<T*>(task);
+      p->~T();
+
+      auto* s = reinterpret_cast<Storage*>(p);
+      for (auto& chunk : chunks_)
+      {
+        auto* top = chunk.storage.get();
+        if (s < top || s >= (top + chunk.used.size())) continue;
+
+        chunk.used[s - top] = false;
+        break;
+      }
+    }
+
+    bool isReusable() const noexcept override
+    {
+      return Reusable<T>::value;
+    }
+
+    // 同時に存在する最大数を指定
+    void reserve(size_t num) noexcept
+    {
+      size_t capacity = 0;
+      for (const auto& chunk : chunks_)
+      {
+        capacity += chunk.used.size();
+      }
+      if (capacity >= num) return;
+
+      chunks_.emplace_back(num - capacity);
+    }
+  };
+
+
+  struct Entry
+  {
+    Task* task;
+    PoolBase* pool;
+    bool finished;
+  };
+
+
+  std::map<std::type_index, std::unique_ptr<PoolBase>> pools_;
+  std::array<std::vector<Entry>, Task::PHASE_NUM> phases_;
+
+  // プールのブロック単位
+  static constexpr size_t CHUNK_SIZE = 2;
+
+
+  template <typename T>
+  Pool<T>& getPool() noexcept
+  {
+    std::type_index key(typeid(T));
+    auto it = pools_.find(key);
+    if (it == std::end(pools_))
+    {
+      it = pools_.emplace(key, std::make_unique<Pool<T>>(size_t(CHUNK_SIZE))).first;
+    }
+
+    return static_cast<Pool<T>&>(*it->second);
+  }
+
+  // 休止中のインスタンスがあれば再開、無ければ生成
+  template <typename T, typename... Args>
+  T* obtain(Pool<T>& pool, std::true_type, Args&&... args) noexcept
+  {
+    if (!pool.suspended) return pool.create(std::forward<Args>(args)...);
+
+    auto* task = static_cast<T*>(pool.suspended);
+    pool.suspended = nullptr;
+    task->resume(std::forward<Args>(args)...);
+    return task;
+  }
+
+  template <typename T, typename... Args>
+  T* obtain(Pool<T>& pool, std::false_type, Args&&... args) noexcept
+  {
+    return pool.create(std::forward<Args>(args)...);
+  }
+
+  template <typename T, typename... Args>
+  Entry make(Args&&... args) noexcept
+  {
+    auto& pool = getPool<T>();
+    auto* task = obtain<T>(pool, Reusable<T>(), std::forward<Args>(args)...);
+
+    return { task, &pool, false };
+  }
+
+  // 終了したタスクを休止または破棄
+  void retire(const Entry& entry) noexcept
+  {
+    auto* pool = entry.pool;
+    if (pool->isReusable() && !pool->suspended)
+    {
+      entry.task->suspend();
+      pool->suspended = entry.task;
+      return;
+    }
+    pool->destroy(entry.task);
+  }
 
 
 public:
   TaskContainer()  = default;
-  ~TaskContainer() = default;
+
+  ~TaskContainer()
+  {
+    clear();
+  }
 
 
   void update(double current_time, double delta_time) noexcept
   {
-    for (auto it = std::begin(tasks_); it != std::end(tasks_); )
+    for (auto& tasks : phases_)
     {
-      if (!(*it)->update(current_time, delta_time))
+      // TIPS 更新中にpushされても良いように添字で回す
+      for (size_t i = 0; i < tasks.size(); ++i)
+      {
+        auto* task = tasks[i].task;
+        if (!task->update(current_time, delta_time))
+        {
+          tasks[i].finished = true;
+        }
+      }
+
+      auto it = std::stable_partition(std::begin(tasks), std::end(tasks),
+                                      [](const Entry& entry)
+                                      {
+                                        return !entry.finished;
+                                      });
+      std::vector<Entry> finished(it, std::end(tasks));
+      tasks.erase(it, std::end(tasks));
+
+      for (const auto& entry : finished)
       {
-        it = tasks_.erase(it);
-        continue;
+        retire(entry);
       }
-      ++it;
     }
   }
 
 
   void clear() noexcept
   {
-    tasks_.clear();
+    for (auto& tasks : phases_)
+    {
+      for (const auto& entry : tasks)
+      {
+        entry.pool->destroy(entry.task);
+      }
+      tasks.clear();
+    }
+
+    for (auto& it : pools_)
+    {
+      auto& pool = *it.second;
+      if (!pool.suspended) continue;
+
+      pool.destroy(pool.suspended);
+      pool.suspended = nullptr;
+    }
   }
 
 
+  // 同時に存在する最大数を予約
+  template <typename T>
+  void reserve(size_t num) noexcept
+  {
+    getPool<T>().reserve(num);
+  }
+
   // 最前へ追加
   template <typename T, typename... Args>
   void pushFront(Args&&... args) noexcept
   {
-    tasks_.push_front(std::make_unique<T>(args...));
+    auto entry = make<T>(std::forward<Args>(args)...);
+    auto& tasks = phases_[entry.task->phase()];
+    tasks.insert(std::begin(tasks), entry);
   }
 
   // 最後尾へ追加
   template <typename T, typename... Args>
   void pushBack(Args&&... args) noexcept
   {
-    tasks_.push_back(std::make_unique<T>(args...));
+    auto entry = make<T>(std::forward<Args>(args)...);
+    phases_[entry.task->phase()].push_back(entry);
   }
 
 };
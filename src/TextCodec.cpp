@@ -3,110 +3,285 @@
 // 
 
 #include "Defines.hpp"
-#include <iostream>
-#include <fstream>
+#include <cstring>
+#include <cstddef>
 #include <cassert>
+#include <algorithm>
 #include <zlib.h>
 #include <cinder/app/App.h>
 #include <cinder/DataTarget.h>
 #include "TextCodec.hpp"
+#include "MappedFile.hpp"
 
 
 namespace ngs { namespace TextCodec {
 
+// TIPS 以前の形式はzlibのストリームのみ
 enum {
-  OUTBUFSIZ = 1024 * 8,
+  HEADER_SIZE = sizeof(Codec::Header),
+  // サイズが分からない時の展開先の最小単位
+  OUTBUFSIZ   = 1024 * 8,
 };
 
 
-// 圧縮
-std::string encode(const std::string& input) noexcept
+Encoder::Encoder() noexcept
+  : z_(std::make_unique<z_stream>())
+{
+  deflateInit(z_.get(), Z_DEFAULT_COMPRESSION);
+}
+
+Encoder::~Encoder()
 {
-  z_stream z;
-  z.zalloc = Z_NULL;
-  z.zfree  = Z_NULL;
-  z.opaque = Z_NULL;
-  deflateInit(&z, Z_DEFAULT_COMPRESSION);
+  deflateEnd(z_.get());
+}
 
-  // SOURCE:http://yak-ex.blogspot.jp/2012/12/c-advent-calendar-2012-8-c-compiler-farm.html
-  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
-  z.avail_in = static_cast<unsigned int>(input.size());
+void Encoder::begin(size_t size_hint, int level) noexcept
+{
+  deflateReset(z_.get());
+  deflateParams(z_.get(), level, Z_DEFAULT_STRATEGY);
 
-  Bytef outbuf[OUTBUFSIZ];
-  z.next_out  = outbuf;
-  z.avail_out = OUTBUFSIZ;
+  // TIPS サイズはfinishで書き込む
+  output_.resize(std::max(size_t(HEADER_SIZE) + deflateBound(z_.get(), uLong(size_hint)), size_t(OUTBUFSIZ)));
+  std::memcpy(&output_[0], Codec::MAGIC, sizeof(Codec::MAGIC));
+  output_[sizeof(Codec::MAGIC)] = Codec::ZLIB;
+  length_     = HEADER_SIZE;
+  input_size_ = 0;
+}
 
-  std::string output;
-  while (1)
+void Encoder::deflate(int flush) noexcept
+{
+  while (true)
   {
-    int status = deflate(&z, Z_FINISH);
-    assert(status != Z_STREAM_ERROR);
-    
-    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    if (length_ == output_.size())
     {
-      u_int count = OUTBUFSIZ - z.avail_out;
-      output.insert(output.end(), &outbuf[0], &outbuf[count]);
-
-      if (status == Z_STREAM_END) break;
-      
-      z.next_out  = outbuf;
-      z.avail_out = OUTBUFSIZ;
+      output_.resize(output_.size() * 2);
     }
+
+    z_->next_out  = reinterpret_cast<Bytef*>(&output_[length_]);
+    z_->avail_out = uInt(output_.size() - length_);
+    int status = ::deflate(z_.get(), flush);
+    assert(status != Z_STREAM_ERROR);
+    length_ = output_.size() - z_->avail_out;
+
+    if (status == Z_STREAM_END) break;
+    if (flush == Z_NO_FLUSH && z_->avail_in == 0 && z_->avail_out > 0) break;
   }
-  deflateEnd(&z);
+}
+
+void Encoder::feed(const void* data, size_t size) noexcept
+{
+  z_->next_in  = const_cast<Bytef*>(static_cast<const Bytef*>(data));
+  z_->avail_in = uInt(size);
+  input_size_ += uint32_t(size);
 
-  return output;
+  deflate(Z_NO_FLUSH);
 }
 
-// 伸長
-std::string decode(const std::string& input) noexcept
+std::string& Encoder::finish() noexcept
 {
-  z_stream z;
-  z.zalloc = Z_NULL;
-  z.zfree  = Z_NULL;
-  z.opaque = Z_NULL;
-  inflateInit(&z);
-  
-  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
-  z.avail_in = static_cast<unsigned int>(input.size());
-
-  Bytef outbuf[OUTBUFSIZ];
-  z.next_out  = outbuf;
-  z.avail_out = OUTBUFSIZ;
-
-  std::string output;
-  while (1) {
-    int status = inflate(&z, Z_NO_FLUSH);
-    if ((status == Z_STREAM_ERROR) || (status == Z_DATA_ERROR))
+  z_->next_in  = Z_NULL;
+  z_->avail_in = 0;
+  deflate(Z_FINISH);
+
+  std::memcpy(&output_[offsetof(Codec::Header, size)], &input_size_, sizeof(input_size_));
+  output_.resize(length_);
+  return output_;
+}
+
+
+Decoder::Decoder() noexcept
+  : z_(std::make_unique<z_stream>())
+{
+  inflateInit(z_.get());
+}
+
+Decoder::~Decoder()
+{
+  inflateEnd(z_.get());
+}
+
+void Decoder::begin() noexcept
+{
+  inflateReset(z_.get());
+  state_ = State::HEADER;
+  header_.clear();
+  output_.clear();
+  length_ = 0;
+}
+
+void Decoder::inflate(const void* data, size_t size) noexcept
+{
+  z_->next_in  = const_cast<Bytef*>(static_cast<const Bytef*>(data));
+  z_->avail_in = uInt(size);
+
+  while (state_ == State::BODY && z_->avail_in > 0)
+  {
+    // NOTICE サイズが分かっていれば一度も伸ばさない
+    if (length_ == output_.size())
+    {
+      if (output_.size() > Codec::MAX_SIZE)
+      {
+        DOUT << "decode error!! too large." << std::endl;
+        state_ = State::BROKEN;
+        break;
+      }
+      output_.resize(std::max(output_.size() * 2, size_t(OUTBUFSIZ)));
+    }
+
+    z_->next_out  = reinterpret_cast<Bytef*>(&output_[length_]);
+    z_->avail_out = uInt(output_.size() - length_);
+    int status = ::inflate(z_.get(), Z_NO_FLUSH);
+    length_ = output_.size() - z_->avail_out;
+
+    if (status == Z_STREAM_END)
+    {
+      state_ = State::END;
+    }
+    else if (status != Z_OK && status != Z_BUF_ERROR)
     {
       // エラーが起こった場合は空の文字列を返す
       DOUT << "decode error!!" << std::endl;
-      
-      inflateEnd(&z);
-      return std::string();
+      state_ = State::BROKEN;
     }
+  }
+}
+
+void Decoder::feed(const void* data, size_t size) noexcept
+{
+  const auto* p = static_cast<const char*>(data);
+
+  if (state_ == State::HEADER)
+  {
+    auto n = std::min(size, HEADER_SIZE - header_.size());
+    header_.append(p, n);
+    p    += n;
+    size -= n;
+    if (header_.size() < HEADER_SIZE) return;
 
-    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    state_ = State::BODY;
+    const auto* header = Codec::getHeader(header_.data(), header_.size());
+    if (header && header->type != Codec::ZLIB)
     {
-      u_int count = OUTBUFSIZ - z.avail_out;
-      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+      DOUT << "decode error!! not zlib." << std::endl;
+      state_ = State::BROKEN;
+      return;
+    }
+    if (header)
+    {
+      uint32_t original_size = header->size;
+      if (original_size > Codec::MAX_SIZE)
+      {
+        DOUT << "decode error!! too large: " << original_size << std::endl;
+        state_ = State::BROKEN;
+        return;
+      }
+      // TIPS 展開が終わったことを知るために1バイト余分に確保
+      output_.resize(size_t(original_size) + 1);
+    }
+    else
+    {
+      // 以前の形式
+      inflate(header_.data(), header_.size());
+    }
+  }
+
+  inflate(p, size);
+}
+
+bool Decoder::finish() noexcept
+{
+  if (state_ == State::HEADER)
+  {
+    // 以前の形式で、ヘッダより短い
+    state_ = State::BODY;
+    inflate(header_.data(), header_.size());
+  }
 
-      if (status == Z_STREAM_END) break;
+  output_.resize(length_);
+  if (state_ != State::END)
+  {
+    output_.clear();
+    return false;
+  }
+  return true;
+}
+
+
+namespace {
+
+// TIPS z_streamはスレッドごとに使い回す
+Encoder& getEncoder() noexcept
+{
+  thread_local Encoder encoder;
+  return encoder;
+}
+
+Decoder& getDecoder() noexcept
+{
+  thread_local Decoder decoder;
+  return decoder;
+}
 
-      z.next_out  = outbuf;
-      z.avail_out = OUTBUFSIZ;
+}
+
+
+// 圧縮
+std::string encode(const std::string& input, const Codec::Method& method) noexcept
+{
+  if (!Codec::isAvailable(method.type))
+  {
+    // TIPS 使えない時はzlibにしておく
+    DOUT << "codec not available: " << method.type << std::endl;
+    return encode(input, Codec::Method{ Codec::ZLIB, Z_DEFAULT_COMPRESSION });
+  }
+  if (method.type != Codec::ZLIB)
+  {
+    return Codec::compress(input.data(), input.size(), method);
+  }
+
+  auto& encoder = getEncoder();
+  encoder.begin(input.size(), method.level);
+  encoder.feed(input.data(), input.size());
+  return std::move(encoder.finish());
+}
+
+std::string encode(const std::string& input, Codec::Usage usage) noexcept
+{
+  return encode(input, Codec::getMethod(usage));
+}
+
+// 伸長
+std::string decode(const void* data, size_t size) noexcept
+{
+  const auto* header = Codec::getHeader(data, size);
+  if (header && header->type != Codec::ZLIB)
+  {
+    std::string output;
+    if (!Codec::decompress(*header, size, output))
+    {
+      DOUT << "decode error!! type: " << header->type << std::endl;
+      return std::string();
     }
+    return output;
   }
-  inflateEnd(&z);
 
-  return output;
+  auto& decoder = getDecoder();
+  decoder.begin();
+  decoder.feed(data, size);
+  decoder.finish();
+  return std::move(decoder.output());
+}
+
+std::string decode(const std::string& input) noexcept
+{
+  return decode(input.data(), input.size());
 }
 
 
 // 書き出し
-void write(const std::string& path, const std::string& input) noexcept
+void write(const std::string& path, const std::string& input, Codec::Usage usage) noexcept
 {
-  auto output = encode(input);
+  auto output = encode(input, usage);
 
   // Cinderにファイル書き出しが用意されていた
   auto data_ref = ci::writeFile(path);
@@ -114,16 +289,13 @@ void write(const std::string& path, const std::string& input) noexcept
 }
 
 // 読み込み
+// TIPS メモリマップしたファイルから直接展開する
 std::string load(const std::string& path) noexcept
 {
-  std::ifstream fstr(path, std::ios::binary);
-  assert(fstr);
+  MappedFile file(path);
+  if (!file.isOpen()) return std::string();
 
-  // SOURCE: http://fa11enprince.hatenablog.com/entry/2014/04/03/233500
-  std::string input((std::istreambuf_iterator<char>(fstr)),
-                    std::istreambuf_iterator<char>());
-    
-  return decode(input);
+  return decode(file.data(), file.size());
 }
 
 } }
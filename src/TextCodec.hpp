@@ -2,17 +2,95 @@
 
 //
 // text encode/decode
+//   先頭に圧縮方法と展開後のサイズを書いておき、展開先を最初に確保する(Codec.hpp)
+//   (サイズの無い以前の形式も読める)
+//   zlibは少しずつ処理でき、それ以外は一度に処理する
 //
 
 #include <string>
+#include <memory>
+#include <cstdint>
+#include <boost/noncopyable.hpp>
+#include "Codec.hpp"
 
 
+struct z_stream_s;
+
 namespace ngs { namespace TextCodec {
 
-std::string encode(const std::string& input) noexcept;
+// zlibで少しずつ圧縮する
+//   begin → feed(何回でも) → finish
+// TIPS z_streamを使い回すので、同じスレッドでは同じインスタンスを使うと良い
+class Encoder
+  : private boost::noncopyable
+{
+  std::unique_ptr<z_stream_s> z_;
+  std::string output_;
+  size_t length_;
+  uint32_t input_size_;
+
+  void deflate(int flush) noexcept;
+
+
+public:
+  Encoder() noexcept;
+  ~Encoder();
+
+  // level: zlibの圧縮レベル(-1で標準)
+  void begin(size_t size_hint = 0, int level = -1) noexcept;
+  void feed(const void* data, size_t size) noexcept;
+  // 戻り値の中身はmoveしても良い
+  std::string& finish() noexcept;
+};
+
+// zlibで少しずつ展開する
+//   begin → feed(何回でも) → finish
+class Decoder
+  : private boost::noncopyable
+{
+  enum class State
+  {
+    HEADER,
+    BODY,
+    END,
+    // TIPS ERRORはWindowsでマクロ定義されている
+    BROKEN,
+  };
+
+  std::unique_ptr<z_stream_s> z_;
+  State state_;
+  std::string header_;
+  std::string output_;
+  size_t length_;
+
+  void inflate(const void* data, size_t size) noexcept;
+
+
+public:
+  Decoder() noexcept;
+  ~Decoder();
+
+  void begin() noexcept;
+  void feed(const void* data, size_t size) noexcept;
+  // 戻り値:false データが壊れている
+  bool finish() noexcept;
+
+  // 戻り値の中身はmoveしても良い
+  std::string& output() noexcept
+  {
+    return output_;
+  }
+};
+
+
+// usage: データの種類ごとに圧縮方法を選ぶ
+std::string encode(const std::string& input, Codec::Usage usage) noexcept;
+std::string encode(const std::string& input, const Codec::Method& method) noexcept;
+// TIPS 圧縮方法はデータの先頭を見て判断する
 std::string decode(const std::string& input) noexcept;
+std::string decode(const void* data, size_t size) noexcept;
 
-void write(const std::string& path, const std::string& input) noexcept;
+void write(const std::string& path, const std::string& input, Codec::Usage usage) noexcept;
 std::string load(const std::string& path) noexcept;
 
 } }
@@ -2,6 +2,7 @@
 
 //
 // タイトル画面
+//   何度も再表示されるので、終了時は休止させて再利用する
 //
 
 #include "Task.hpp"
@@ -38,20 +39,18 @@ public:
   };
 
 
+  // TaskContainerで再利用する
+  static constexpr bool reusable = true;
+
+
   Title(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
-        const Condition& condition) noexcept
+        UI::CanvasCache& canvas_cache, const Condition& condition) noexcept
     : event_(event),
       effect_speed_(params.getValueForKey<double>("title.effect_speed")),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("title.canvas")),
-              Params::load(params.getValueForKey<std::string>("title.tweens")))
+              canvas_cache.get(params, "title"))
   {
-    {
-      auto v = condition.first_time ? "title.se_first"
-                                    : "title.se";
-      startTimelineSound(event, params, v);
-    }
     auto wipe_delay    = params.getValueForKey<double>("ui.wipe.delay");
     auto wipe_duration = params.getValueForKey<double>("ui.wipe.duration");
 
@@ -187,11 +186,12 @@ public:
                               });
 
 #if defined (DEBUG)
-    holder_ += event_.connect("debug-gamecenter",
-                              [this](const Connection&, const Arguments&)
-                              {
-                                force_game_center_ = !force_game_center_;
-                              });
+    // NOTICE 休止中も切り替えられるように、休止時に止めない方へ登録
+    debug_holder_ += event_.connect("debug-gamecenter",
+                                    [this](const Connection&, const Arguments&)
+                                    {
+                                      force_game_center_ = !force_game_center_;
+                                    });
 #endif
 
     // ボタンイベント共通Tween
@@ -203,6 +203,46 @@ public:
     setupCommonTweens(event_, holder_, canvas_, "purchase");
     setupCommonTweens(event_, holder_, canvas_, "play");
 
+    begin(params, condition);
+  }
+
+  ~Title() = default;
+
+
+  // 休止状態から再開
+  void resume(const ci::JsonTree& params, Event<Arguments>&, UI::Drawer&, TweenCommon&, UI::CanvasCache&,
+              const Condition& condition) noexcept
+  {
+    canvas_.reset();
+    canvas_.suspend(false);
+    holder_.block(false);
+
+    begin(params, condition);
+  }
+  
+
+private:
+  void suspend() noexcept override
+  {
+    count_exec_.clear();
+    holder_.block();
+    canvas_.suspend();
+  }
+
+  // 画面の開始
+  void begin(const ci::JsonTree& params, const Condition& condition) noexcept
+  {
+    active_       = true;
+    game_center_  = false;
+    has_purchase_ = false;
+    purchased_    = false;
+
+    {
+      auto v = condition.first_time ? "title.se_first"
+                                    : "title.se";
+      startTimelineSound(event_, params, v);
+    }
+
     if (!condition.saved || condition.tutorial) 
     {
       // Saveデータがない場合関連するボタンを消す
@@ -243,13 +283,9 @@ public:
       startMainTween(params, 0.6);
     }
 
-    event.signal("Title:begin", Arguments());
+    event_.signal("Title:begin", Arguments());
   }
 
-  ~Title() = default;
-  
-
-private:
   bool update(double current_time, double delta_time) noexcept override
   {
     count_exec_.update(delta_time);
@@ -384,6 +420,9 @@ private:
 
   Event<Arguments>& event_;
   ConnectionHolder holder_;
+#if defined (DEBUG)
+  ConnectionHolder debug_holder_;
+#endif
 
   CountExec count_exec_;
 
@@ -41,12 +41,12 @@ class Tutorial
 
 
 public:
-  Tutorial(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common)
+  Tutorial(const ci::JsonTree& params, Event<Arguments>& event, UI::Drawer& drawer, TweenCommon& tween_common,
+           UI::CanvasCache& canvas_cache)
     : event_(event),
       canvas_(event, drawer, tween_common,
               params["ui.camera"],
-              Params::load(params.getValueForKey<std::string>("tutorial.canvas")),
-              Params::load(params.getValueForKey<std::string>("tutorial.tweens"))),
+              canvas_cache.get(params, "tutorial")),
       offset_special_(Json::getVec<glm::vec2>(params["tutorial.offset_special"])),
       offset_common_(Json::getVec<glm::vec2>(params["tutorial.offset_common"]))
   {
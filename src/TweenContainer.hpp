@@ -2,16 +2,15 @@
 
 //
 // Tweenのコンテナ
+//   TIPS 雛形(CanvasCache)から複製して使うのでコピーできる
 //
 
-#include <boost/noncopyable.hpp>
 #include "Tween.hpp"
 
 
 namespace ngs {
 
 class TweenContainer
-  : private boost::noncopyable
 {
 
 
@@ -27,6 +27,11 @@ class Brank
     return nullptr;
   }
 
+  std::unique_ptr<WidgetBase> clone() const noexcept override
+  {
+    return std::make_unique<Brank>(*this);
+  }
+
 
 public:
   Brank()  = default;
@@ -2,16 +2,18 @@
 
 //
 // UIの最上位
+//   Widgetの階層とTweenは雛形(CanvasCache)を複製して作る
 //
 
 #include <map>
 #include <string>
 #include <boost/noncopyable.hpp>
 #include <cinder/Timeline.h>
-#include "UIWidgetsFactory.hpp"
+#include "UICanvasCache.hpp"
 #include "UIDrawer.hpp"
 #include "Camera.hpp"
 #include "TweenContainer.hpp"
+#include "Profiler.hpp"
 
 
 namespace ngs { namespace UI {
@@ -25,15 +27,15 @@ public:
          UI::Drawer& drawer,
          TweenCommon& tween_common,
          const ci::JsonTree& camera_params,
-         const ci::JsonTree& widgets_params,
-         const ci::JsonTree& tween_params) noexcept
+         const UI::CanvasCache::Template& layout) noexcept
     : event_(event),
       drawer_(drawer),
       tween_common_(tween_common),
       camera_(camera_params),
-      widgets_(widgets_factory_.construct(widgets_params)),
+      layout_(layout),
+      widgets_(layout.widgets->clone()),
       timeline_(ci::Timeline::create()),
-      tweens_(tween_params)
+      tweens_(layout.tweens)
   {
     // FIXME near_zピッタリの位置だとmacOSのReleaseビルドで絵が出ない
     camera_.body().lookAt(glm::vec3(0, 0, camera_.getNearClip() + 0.001f), glm::vec3());
@@ -264,6 +266,30 @@ public:
   }
 
 
+  // 休止中はイベントを受け付けず描画もしない
+  void suspend(bool enable = true) noexcept
+  {
+    holder_.block(enable);
+
+    // TIPS 休止中の"resize"は受け取っていないので、再開時に反映する
+    if (!enable) camera_.resize();
+  }
+
+  // Widgetを生成直後の状態に戻す
+  // TIPS 雛形の複製だけで済み、イベント登録も省略できる
+  void reset() noexcept
+  {
+    timeline_->clear();
+
+    query_widgets_.clear();
+    enumerated_widgets_.clear();
+    widgets_ = layout_.widgets->clone();
+    makeQueryWidgets(widgets_);
+
+    active(true);
+  }
+
+
 private:
   void resize(const Connection&, const Arguments&) noexcept
   {
@@ -281,6 +307,8 @@ private:
 #if defined (DEBUG)
     if (debug_draw_) return;
 #endif
+    PROFILE_SCOPE("Canvas::draw");
+
     ci::gl::enableDepth(false);
     ci::gl::disable(GL_CULL_FACE);
     ci::gl::enableAlphaBlending();
@@ -488,7 +516,8 @@ private:
 
   Camera camera_;
 
-  UI::WidgetsFactory widgets_factory_;
+  // 雛形(再構築用)
+  const UI::CanvasCache::Template& layout_;
   UI::WidgetPtr widgets_; 
 
   // クエリ用
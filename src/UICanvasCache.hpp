@@ -0,0 +1,76 @@
+﻿#pragma once
+
+//
+// Canvasの雛形
+//   画面ごとのJSONは最初に使った時に一度だけ読み込み、Widgetの階層とTweenを作っておく
+//   Canvasは雛形を複製して使う
+//   NOTICE 雛形は変更しないこと
+//
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <boost/noncopyable.hpp>
+#include "UIWidgetsFactory.hpp"
+#include "TweenContainer.hpp"
+#include "Params.hpp"
+
+
+namespace ngs { namespace UI {
+
+class CanvasCache
+  : private boost::noncopyable
+{
+
+public:
+  struct Template
+  {
+    Template(WidgetsFactory& factory,
+             const ci::JsonTree& widgets_params,
+             const ci::JsonTree& tween_params) noexcept
+      : widgets(factory.construct(widgets_params)),
+        tweens(tween_params)
+    {}
+
+    WidgetPtr widgets;
+    TweenContainer tweens;
+  };
+
+
+  CanvasCache()  = default;
+  ~CanvasCache() = default;
+
+
+  // canvas, tweens: JSONのパス
+  const Template& get(const std::string& canvas, const std::string& tweens) noexcept
+  {
+    auto key = canvas + ":" + tweens;
+    auto it = templates_.find(key);
+    if (it == std::end(templates_))
+    {
+      DOUT << "CanvasCache: " << key << std::endl;
+      it = templates_.emplace(std::piecewise_construct,
+                              std::forward_as_tuple(key),
+                              std::forward_as_tuple(widgets_factory_,
+                                                    Params::load(canvas), Params::load(tweens))).first;
+    }
+
+    return it->second;
+  }
+
+  // 画面用のパラメーター(xxx.canvas と xxx.tweens)から
+  const Template& get(const ci::JsonTree& params, const std::string& name) noexcept
+  {
+    return get(params.getValueForKey<std::string>(name + ".canvas"),
+               params.getValueForKey<std::string>(name + ".tweens"));
+  }
+
+
+private:
+  UI::WidgetsFactory widgets_factory_;
+
+  // std::mapなので参照は無効にならない
+  std::map<std::string, Template> templates_;
+};
+
+} }
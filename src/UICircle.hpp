@@ -59,6 +59,11 @@ public:
 
 
 private:
+  std::unique_ptr<WidgetBase> clone() const noexcept override
+  {
+    return std::make_unique<Circle>(*this);
+  }
+
   void draw(const ci::Rectf& rect, UI::Drawer& drawer, float alpha) noexcept override
   {
     ci::gl::ScopedGlslProg prog(drawer.getColorShader());
@@ -44,6 +44,11 @@ public:
 
 
 private:
+  std::unique_ptr<WidgetBase> clone() const noexcept override
+  {
+    return std::make_unique<Text>(*this);
+  }
+
   void draw(const ci::Rectf& rect, UI::Drawer& drawer, float alpha) noexcept override
   {
     auto& font = drawer.getFont(font_name_);
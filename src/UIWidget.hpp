@@ -326,6 +326,43 @@ public:
   }
 
 
+  // 複製(子供も含む)
+  // TIPS JSONから作るより速いので、雛形(CanvasCache)から生成する時に使う
+  WidgetPtr clone() const noexcept
+  {
+    auto widget = std::make_shared<UI::Widget>(rect_);
+
+    widget->identifier_    = identifier_;
+    widget->enable_        = enable_;
+    widget->parent_enable_ = parent_enable_;
+    widget->active_        = active_;
+    widget->offset_        = offset_;
+    widget->pivot_         = pivot_;
+    widget->anchor_min_    = anchor_min_;
+    widget->anchor_max_    = anchor_max_;
+    widget->scale_         = scale_;
+    widget->has_event_     = has_event_;
+    widget->event_         = event_;
+    widget->move_event_    = move_event_;
+    widget->se_            = se_;
+    widget->alpha_         = alpha_;
+    widget->disp_rect_     = disp_rect_;
+#if defined (DEBUG)
+    widget->disp_color_    = disp_color_;
+#endif
+
+    widget->widget_base_ = widget_base_->clone();
+
+    widget->children_.reserve(children_.size());
+    for (const auto& child : children_)
+    {
+      widget->children_.push_back(child->clone());
+    }
+
+    return widget;
+  }
+
+
   // 非表示なWidgetの検査
   static void checkInactiveWidget(const WidgetPtr& widget) noexcept
   {
@@ -4,6 +4,7 @@
 // Widget描画基本クラス
 //
 
+#include <memory>
 #include <boost/any.hpp>
 #include "UIDrawer.hpp"
 
@@ -11,7 +12,6 @@
 namespace ngs { namespace UI {
 
 struct WidgetBase
-  : private boost::noncopyable
 {
   virtual ~WidgetBase() = default;
 
@@ -20,6 +20,15 @@ struct WidgetBase
   virtual void setParam(const std::string& name, const boost::any& values) noexcept = 0; 
   virtual boost::any getParam(const std::string& name) noexcept = 0; 
 
+  // 雛形からの複製(Widget::clone)
+  virtual std::unique_ptr<WidgetBase> clone() const noexcept = 0;
+
+
+protected:
+  // TIPS 複製はclone()でのみ行う
+  WidgetBase() = default;
+  WidgetBase(const WidgetBase&) = default;
+  WidgetBase& operator=(const WidgetBase&) = delete;
 };
 
 } }
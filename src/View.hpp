@@ -6,6 +6,8 @@
 
 #include <boost/noncopyable.hpp>
 #include <deque>
+#include <array>
+#include <cstddef>
 #include <cinder/TriMesh.h>
 #include <cinder/gl/Vbo.h>
 #include <cinder/gl/Batch.h>
@@ -13,11 +15,15 @@
 #include <cinder/ObjLoader.h>
 #include <cinder/ImageIo.h>
 #include <cinder/Timeline.h>
+#include <cinder/Frustum.h>
 #include "PLY.hpp"
 #include "Model.hpp"
 #include "Shader.hpp"
 #include "Utility.hpp"
 #include "EaseFunc.hpp"
+#include "Profiler.hpp"
+#include "InstanceBuffer.hpp"
+#include "ModelStreamer.hpp"
 
 
 namespace ngs {
@@ -26,21 +32,43 @@ enum {
   PANEL_SIZE = 20,
 
   EFFECT_NUM     = 10,
-  EFFECT_MAX_NUM = 256
+  EFFECT_MAX_NUM = 256,
+
+  // モデルごとのインスタンスバッファの初期サイズ
+  PANEL_INSTANCE_NUM = 16,
+
+  // カリング用の空間インデックスの1区画(マス数)
+  FIELD_GRID_SIZE = 4,
+
+  // 雲のモデルごとのインスタンスバッファの初期サイズ
+  CLOUD_INSTANCE_NUM = 4
 };
 
 
 class View
   : private boost::noncopyable
 {
-  // 演出用の定義
-  struct Effect
+  // 得点時演出のパーティクル
+  //   固定長のSoAで持ち、経過時間から位置を直接求める
+  //   Y方向にしか動かないのでXZは固定
+  struct EffectPool
   {
-    bool active;
-    bool disp;
-    glm::vec3 pos;
-    glm::vec3 scale;
-    ci::Color color;
+    size_t num = 0;
+
+    // 経過時間(負の間は開始待ち)
+    std::array<float, EFFECT_MAX_NUM> time;
+    std::array<float, EFFECT_MAX_NUM> duration;
+
+    std::array<float, EFFECT_MAX_NUM> x;
+    std::array<float, EFFECT_MAX_NUM> z;
+    std::array<float, EFFECT_MAX_NUM> start_y;
+    std::array<float, EFFECT_MAX_NUM> move_y;
+
+    std::array<float, EFFECT_MAX_NUM> scale;
+    std::array<ci::Color, EFFECT_MAX_NUM> color;
+
+    // 描画時の作業用(Easing適用後の進行度)
+    std::array<float, EFFECT_MAX_NUM> rate;
   };
 
   struct Blank
@@ -63,6 +91,86 @@ class View
     int rotate_index;
     // 道や森が完成した時の演出用
     float top_y;
+
+    // 描画単位
+    int group;
+    // 行列の再計算が必要
+    bool dirty;
+    // このフレームで動いた(影のキャッシュに含めない)
+    bool moving;
+    // カリング用
+    ci::AxisAlignedBox aabb;
+  };
+
+  // インスタンシング用の1枚分のデータ
+  struct PanelInstance
+  {
+    glm::mat4 matrix;
+    float diffuse_power;
+    float top_y;
+  };
+
+  // インスタンシングの描画単位
+  struct PanelBatch
+  {
+    explicit PanelBatch(size_t capacity) noexcept
+      : instances(capacity)
+    {}
+
+    InstanceBuffer<PanelInstance> instances;
+    ci::gl::BatchRef model;
+
+    // カリング時の作業用
+    size_t num = 0;
+  };
+
+  // 同じモデルのパネルをまとめて描画する
+  //   カリング結果がパスごとに違うのでバッファも別
+  //   描画はLODごと、影は一番粗いLODで描く(どのLODも形は同じ)
+  struct PanelGroup
+  {
+    PanelGroup() noexcept
+      : shadow(PANEL_INSTANCE_NUM)
+    {}
+
+    // NOTICE InstanceBufferはコピーできないのでstd::vectorではない
+    std::deque<PanelBatch> lods;
+    PanelBatch shadow;
+
+    // モデル座標系でのAABB
+    ci::AxisAlignedBox aabb;
+  };
+
+  // 同じモデルの雲をまとめて描画する
+  struct CloudGroup
+  {
+    explicit CloudGroup(size_t capacity) noexcept
+      : instances(capacity),
+        shadow_instances(capacity)
+    {}
+
+    InstanceBuffer<glm::mat4> instances;
+    InstanceBuffer<glm::mat4> shadow_instances;
+    ci::gl::BatchRef model;
+    ci::gl::BatchRef shadow_model;
+
+    ci::AxisAlignedBox aabb;
+    size_t num = 0;
+  };
+
+  // 空間インデックスの1区画
+  struct GridBlock
+  {
+    // field_panels_の添字
+    std::vector<size_t> panels;
+    ci::AxisAlignedBox aabb;
+    bool dirty = true;
+  };
+
+  struct EffectInstance
+  {
+    glm::mat4 matrix;
+    ci::Color color;
   };
 
 
@@ -146,6 +254,7 @@ public:
       panel_path.push_back(p.getValue<std::string>());
     }
     panel_models.resize(panel_path.size());
+    panel_group_index_.resize(panel_path.size(), -1);
 
     panel_aabb_ = ci::AxisAlignedBox(glm::vec3(-PANEL_SIZE / 2, 0, -PANEL_SIZE / 2),
                                      glm::vec3( PANEL_SIZE / 2, 2,  PANEL_SIZE / 2));
@@ -158,6 +267,8 @@ public:
       setupShadowMap(size);
     }
 
+    panel_lod_size_ = Json::getVec<glm::vec2>(params["panel_lod_size"]);
+
     {
       auto name = params.getValueForKey<std::string>("field.shader");
       field_shader_ = createShader(name, name);
@@ -168,45 +279,67 @@ public:
       field_shader_->uniform("uShininess", params.getValueForKey<float>("field.shininess"));
       field_shader_->uniform("uAmbient", params.getValueForKey<float>("field.ambient"));
     }
+    {
+      // 読み込み中のパネルの代わりに表示する箱
+      ci::ColorA color(0.45f, 0.55f, 0.35f, 1.0f);
+      placeholder_mesh_  = ci::gl::VboMesh::create(ci::geom::Cube().size(panel_aabb_.getSize())
+                                                                    .colors(color, color, color, color, color, color)
+                                                   >> ci::geom::Translate(panel_aabb_.getCenter()));
+      placeholder_model_ = ci::gl::Batch::create(placeholder_mesh_, field_shader_);
+
+      // 全てのパネルを裏で読み込んでおく
+      for (const auto& path : panel_path)
+      {
+        panel_streamer_.request(path, ModelStreamer::LOW);
+      }
+    }
+    {
+      // Fieldのパネルはモデルごとにインスタンシング
+      panel_shader_ = createShader("field_instanced", "blank");
+      panel_shader_->uniform("uShadowMap", 0);
+      panel_shader_->uniform("uSpecular", Json::getColor<float>(params["field.specular"]));
+      panel_shader_->uniform("uShininess", params.getValueForKey<float>("field.shininess"));
+      panel_shader_->uniform("uAmbient", params.getValueForKey<float>("field.ambient"));
+
+      panel_shadow_shader_ = createShader("shadow_instanced", "shadow");
+    }
     {
       blank_shader_ = createShader("blank", "blank");
       blank_shader_->uniform("uShadowMap", 0);
       blank_shader_->uniform("uSpecular", Json::getColor<float>(params["field.specular"]));
       blank_shader_->uniform("uShininess", params.getValueForKey<float>("field.shininess"));
       blank_shader_->uniform("uAmbient", params.getValueForKey<float>("field.ambient"));
+      // TIPS 明滅は時間と位置だけで決まるのでシェーダーで計算する
+      blank_shader_->uniform("uBlankEffect", blank_effect_);
+      blank_shader_->uniform("uBlankDiffuse", blank_diffuse_);
 
       auto model = ci::gl::VboMesh::create(PLY::load(params.getValueForKey<std::string>("blank_model")));
 
       {
-        std::vector<glm::mat4> matrix(72 * 2 + 2);
-        blank_matrix_ = ci::gl::Vbo::create(GL_ARRAY_BUFFER, matrix.size() * sizeof(glm::mat4), matrix.data(), GL_DYNAMIC_DRAW);
+        blank_instances_ = std::make_unique<InstanceBuffer<glm::mat4>>(72 * 2 + 2);
 
         ci::geom::BufferLayout layout;
         layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(glm::mat4), 0, 1 /* per instance */);
-        model->appendVbo(layout, blank_matrix_);
-      }
-      {
-        std::vector<float> diffuse(72 * 2 + 2);
-        blank_diffuse_power_ = ci::gl::Vbo::create(GL_ARRAY_BUFFER, diffuse.size() * sizeof(float), diffuse.data(), GL_DYNAMIC_DRAW);
-
-        ci::geom::BufferLayout layout;
-        layout.append(ci::geom::Attrib::CUSTOM_1, 1, sizeof(float), 0, 1 /* per instance */);
-        model->appendVbo(layout, blank_diffuse_power_);
+        model->appendVbo(layout, blank_instances_->vbo());
       }
+      blank_aabb_ = PLY::load(params.getValueForKey<std::string>("blank_model")).calcBoundingBox();
 
       blank_model_ = ci::gl::Batch::create(model, blank_shader_,
                                            {
                                              { ci::geom::Attrib::CUSTOM_0, "vInstanceMatrix" },
-                                             { ci::geom::Attrib::CUSTOM_1, "uDiffusePower" },
                                              });
     }
     {
       // 処理負荷軽減のため専用モデルを用意
-      auto model = createVboMesh(params.getValueForKey<std::string>("blank_shadow_model"), false);
+      auto tri_mesh = loadObj(params.getValueForKey<std::string>("blank_shadow_model"), false);
+      auto model    = ci::gl::VboMesh::create(tri_mesh);
+      blank_aabb_.include(tri_mesh.calcBoundingBox());
+
+      blank_shadow_instances_ = std::make_unique<InstanceBuffer<glm::mat4>>(72 * 2 + 2);
 
       ci::geom::BufferLayout layout;
       layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(glm::mat4), 0, 1 /* per instance */);
-      model->appendVbo(layout, blank_matrix_);
+      model->appendVbo(layout, blank_shadow_instances_->vbo());
 
       blank_shadow_shader_ = createShader("blank_shadow", "shadow");
 
@@ -253,6 +386,13 @@ public:
     cloud_area_  = params.getValueForKey<float>("cloud_area");
     cloud_color_ = Json::getColorA<float>(params["cloud_color"]);
 
+    {
+      auto name = params.getValueForKey<std::string>("cloud_shader");
+      cloud_shader_ = createShader(name + "_instanced", name);
+      cloud_shader_->uniform("uColor", cloud_color_);
+      cloud_shader_->uniform("uThreshold", params.getValueForKey<float>("cloud_threshold"));
+    }
+
     {
       // モデル準備
       std::vector<std::pair<glm::vec3, float>> cloud_bc;
@@ -262,7 +402,10 @@ public:
         const auto& p = cloud.getValue<std::string>();
 
         auto tri_mesh = loadObj(p, false);
-        cloud_models_.push_back(ci::gl::VboMesh::create(tri_mesh));
+        cloud_groups_.emplace_back(CLOUD_INSTANCE_NUM);
+        setupCloudGroup(cloud_groups_.back(), ci::gl::VboMesh::create(tri_mesh));
+        cloud_groups_.back().aabb = tri_mesh.calcBoundingBox();
+
         auto bc = calcBoundingCircle(tri_mesh);
         bc.first  *= cloud_scale_.x;
         bc.second *= cloud_scale_.x;
@@ -270,14 +413,8 @@ public:
       }
 
       // 雲のレイアウト
-      layoutClouds(params, int(cloud_models_.size()), cloud_bc);
-    }
-
-    {
-      auto name = params.getValueForKey<std::string>("cloud_shader");
-      cloud_shader_ = createShader(name, name);
-      cloud_shader_->uniform("uColor", cloud_color_);
-      cloud_shader_->uniform("uThreshold", params.getValueForKey<float>("cloud_threshold"));
+      layoutClouds(params, int(cloud_groups_.size()), cloud_bc);
+      calcCloudMatrix();
     }
     cloud_texture_ = ci::gl::Texture2d::create(ci::loadImage(Asset::load(params.getValueForKey<std::string>("cloud_texture"))));
 
@@ -290,23 +427,19 @@ public:
       // effect_shader_->uniform("uShininess", params.getValueForKey<float>("field.shininess"));
       effect_shader_->uniform("uAmbient", params.getValueForKey<float>("effect.ambient"));
 
-      auto model = createVboMesh(params.getValueForKey<std::string>("effect.model"), true);
+      effect_ease_func_ = getEaseFunc(effect_ease_);
 
-      {
-        std::vector<glm::mat4> matrix(EFFECT_MAX_NUM);
-        effect_matrix_ = ci::gl::Vbo::create(GL_ARRAY_BUFFER, matrix.size() * sizeof(glm::mat4), matrix.data(), GL_DYNAMIC_DRAW);
+      auto tri_mesh = loadObj(params.getValueForKey<std::string>("effect.model"), true);
+      auto model    = ci::gl::VboMesh::create(tri_mesh);
+      effect_aabb_  = tri_mesh.calcBoundingBox();
 
-        ci::geom::BufferLayout layout;
-        layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(glm::mat4), 0, 1 /* per instance */);
-        model->appendVbo(layout, effect_matrix_);
-      }
       {
-        std::vector<ci::Color> diffuse(EFFECT_MAX_NUM);
-        effect_color_ = ci::gl::Vbo::create(GL_ARRAY_BUFFER, diffuse.size() * sizeof(ci::Color), diffuse.data(), GL_DYNAMIC_DRAW);
+        effect_instances_ = std::make_unique<InstanceBuffer<EffectInstance>>(EFFECT_MAX_NUM);
 
         ci::geom::BufferLayout layout;
-        layout.append(ci::geom::Attrib::CUSTOM_1, 3, sizeof(ci::Color), 0, 1 /* per instance */);
-        model->appendVbo(layout, effect_color_);
+        layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(EffectInstance), offsetof(EffectInstance, matrix), 1 /* per instance */);
+        layout.append(ci::geom::Attrib::CUSTOM_1, 3, sizeof(EffectInstance), offsetof(EffectInstance, color), 1 /* per instance */);
+        model->appendVbo(layout, effect_instances_->vbo());
       }
 
       effect_model_ = ci::gl::Batch::create(model, effect_shader_,
@@ -323,16 +456,12 @@ public:
   // Timelineとかの更新
   void update(double delta_time, bool game_paused) noexcept
   {
+    receivePanelModels();
+
     put_gauge_timer_ += delta_time;
     force_timeline_->step(delta_time);
     transition_timeline_->step(delta_time);
 
-    if (update_translate_)
-    {
-      updateFieldPanels();
-      update_translate_ = false;
-    }
-
     if (clouds_active_)
     {
       updateClouds(delta_time);
@@ -346,6 +475,7 @@ public:
     // NOTE 以下Paush中は処理しない
     if (game_paused) return;
 
+    updateEffect(delta_time);
     timeline_->step(delta_time);
   }
 
@@ -362,7 +492,7 @@ public:
     // field_panels_.clear();
     // field_panel_indices_.clear();
     blank_panels_.clear();
-    effects_.clear();
+    effect_pool_.num = 0;
 
     field_rotate_offset_ = 0.0f;
     update_translate_    = false;
@@ -371,8 +501,7 @@ public:
   void clearAll()
   {
     clear();
-    field_panels_.clear();
-    field_panel_indices_.clear();
+    clearFieldPanels();
     blank_panels_.clear();
   }
 
@@ -383,6 +512,7 @@ public:
     field_color_ = color;
 
     field_shader_->uniform("u_color", color);
+    panel_shader_->uniform("u_color", color);
     blank_shader_->uniform("u_color", color);
     bg_shader_->uniform("u_color", color);
     cloud_shader_->uniform("uColor", mulColor(cloud_color_, color));
@@ -395,6 +525,7 @@ public:
     option.updateFn([this]() noexcept
                     {
                       field_shader_->uniform("u_color", field_color_());
+                      panel_shader_->uniform("u_color", field_color_());
                       blank_shader_->uniform("u_color", field_color_());
                       bg_shader_->uniform("u_color", field_color_());
                       cloud_shader_->uniform("uColor", mulColor(cloud_color_, field_color_()));
@@ -444,6 +575,8 @@ public:
     // PAUSEで回転する時の適当なindex
     int rotate_index = (pos.x + pos.y * 3) & 0b11;
 
+    auto group = getPanelGroup(index);
+
     Panel panel{
       pos,
       position,
@@ -453,8 +586,12 @@ public:
       index,
       rotate_index,
       0.0f,
+      group,
+      true,
+      true,
     };
 
+    field_grid_[calcGridBlock(pos)].panels.push_back(field_panels_.size());
     field_panel_indices_.insert({ pos, field_panels_.size() });
     field_panels_.push_back(panel);
   }
@@ -501,7 +638,7 @@ public:
   }
 
   // パネルの行列を更新する
-  void updateFieldPanels()
+  void updateFieldPanelMatrix(Panel& p) const noexcept
   {
     glm::vec2 offset[] {
       {  field_rotate_offset_, 0.0f },
@@ -509,16 +646,36 @@ public:
       { 0.0f,  field_rotate_offset_ },
       { 0.0f, -field_rotate_offset_ },
     };
+    const auto& ofs = offset[p.rotate_index];
 
-    for (auto& p : field_panels_)
-    {
-      const auto& ofs = offset[p.rotate_index];
+    p.matrix = glm::translate(p.position)
+               * glm::eulerAngleXYZ(p.rotation.x + ofs.x, p.rotation.y, p.rotation.z + ofs.y);
+  }
 
-      p.matrix = glm::translate(p.position)
-                 * glm::eulerAngleXYZ(p.rotation.x + ofs.x, p.rotation.y, p.rotation.z + ofs.y);
+  void clearFieldPanels() noexcept
+  {
+    field_panels_.clear();
+    field_panel_indices_.clear();
+    field_grid_.clear();
+    moving_panels_.clear();
+    shadow_cache_valid_ = false;
+
+    for (auto& group : panel_groups_)
+    {
+      for (auto& lod : group.lods)
+      {
+        lod.instances.clear();
+      }
+      group.shadow.instances.clear();
     }
   }
 
+  // 盤面の座標→空間インデックスの区画
+  static glm::ivec2 calcGridBlock(const glm::ivec2& pos) noexcept
+  {
+    return glm::ivec2(glm::floor(glm::vec2(pos) / float(FIELD_GRID_SIZE)));
+  }
+
   // パネル位置決め
   void setPanelPosition(const glm::vec3& pos) noexcept
   {
@@ -558,14 +715,11 @@ public:
     auto option = timeline_->applyPtr(&p.position.y, 0.0f,
                                       duration, getEaseFunc(ease));
 
-    // 事前計算も必要なので、関数ポインタを利用
-    auto func = [&p]()
-                {
-                  p.matrix = glm::translate(p.position)
-                           * glm::eulerAngleXYZ(p.rotation.x, p.rotation.y, p.rotation.z);
-                };
-    func();
-    option.updateFn(func);
+    p.dirty = true;
+    option.updateFn([&p]()
+                    {
+                      p.dirty = true;
+                    });
   }
 
   // 次のパネルの出現演出
@@ -662,51 +816,52 @@ public:
                    {
                      glm::vec3 gpos = vec2ToVec3(pos * int(PANEL_SIZE));
 
+                     auto& pool = effect_pool_;
                      for (int i = 0; i < EFFECT_NUM; ++i)
                      {
-                       if (effects_.size() == EFFECT_MAX_NUM) break;
+                       if (pool.num == EFFECT_MAX_NUM) break;
 
                        glm::vec3 ofs{
                          ci::randFloat(-PANEL_SIZE / 2, PANEL_SIZE / 2),
                          randFromVec2(effect_y_ofs_),
                          ci::randFloat(-PANEL_SIZE / 2, PANEL_SIZE / 2)
                        };
-                       effects_.push_back({ true, false, gpos + ofs });
-                       auto& effect = effects_.back();
-
-                       auto end_pos = gpos + ofs + glm::vec3(0, randFromVec2(effect_y_move_), 0);
-
-                       float duration = randFromVec2(effect_duration_);
-                       float delay    = randFromVec2(effect_delay_);
-
-                       auto options = timeline_->applyPtr(&effect.pos, end_pos, duration, getEaseFunc(effect_ease_));
-
-                       options.delay(delay);
-                       options.startFn([&effect, this]() noexcept
-                                       {
-                                         effect.disp  = true;
-                                         effect.scale = glm::vec3(randFromVec2(effect_scale_));
-                                         glm::vec3 hsv{
-                                           randFromVec2(effect_h_), 
-                                           randFromVec2(effect_s_),
-                                           1.0f
-                                         };
-                                         effect.color = ci::hsvToRgb(hsv);
-                                       });
-                       options.finishFn([&effect]() noexcept
-                                        {
-                                          effect.active = false;
-                                        });
+                       auto p = gpos + ofs;
+
+                       auto n = pool.num;
+                       pool.x[n]       = p.x;
+                       pool.z[n]       = p.z;
+                       pool.start_y[n] = p.y;
+                       pool.move_y[n]  = randFromVec2(effect_y_move_);
+
+                       pool.duration[n] = randFromVec2(effect_duration_);
+                       pool.time[n]     = -randFromVec2(effect_delay_);
+
+                       pool.scale[n] = randFromVec2(effect_scale_);
+                       glm::vec3 hsv{
+                         randFromVec2(effect_h_), 
+                         randFromVec2(effect_s_),
+                         1.0f
+                       };
+                       pool.color[n] = ci::hsvToRgb(hsv);
+
+                       ++pool.num;
                      }
 
                      // パネル発光演出
                      if (field_panel_indices_.count(pos))
                      {
                        auto index  = field_panel_indices_.at(pos);
-                       auto& value = field_panels_[index].diffuse_power;
+                       auto& panel = field_panels_[index];
+                       auto func = [&panel]()
+                                   {
+                                     panel.dirty = true;
+                                   };
       
-                       timeline_->applyPtr(&value, complete_diffuse_, complete_begin_duration_, getEaseFunc(complete_begin_ease_));
-                       timeline_->appendToPtr(&value, 1.0f, complete_end_duration_, getEaseFunc(complete_end_ease_));
+                       timeline_->applyPtr(&panel.diffuse_power, complete_diffuse_, complete_begin_duration_, getEaseFunc(complete_begin_ease_))
+                         .updateFn(func);
+                       timeline_->appendToPtr(&panel.diffuse_power, 1.0f, complete_end_duration_, getEaseFunc(complete_end_ease_))
+                         .updateFn(func);
                      }
                    },
                    timeline_->getCurrentTime() + delay);
@@ -716,10 +871,14 @@ public:
   void effectPanelScaing(const glm::ivec2& pos, float delay)
   {
     auto index  = field_panel_indices_.at(pos);
-    auto& value = field_panels_[index].top_y;
+    auto& panel = field_panels_[index];
 
-    auto option = timeline_->applyPtr(&value, 1.0f, 0.8f, getEaseFunc("OutBack"));
+    auto option = timeline_->applyPtr(&panel.top_y, 1.0f, 0.8f, getEaseFunc("OutBack"));
     option.delay(delay);
+    option.updateFn([&panel]()
+                    {
+                      panel.dirty = true;
+                    });
   }
 
 
@@ -780,17 +939,16 @@ public:
 
       auto delay = ci::randFloat(0.0f, 0.25f);
       option.delay(delay);
-      option.updateFn([this]()
+      option.updateFn([&panel]()
                       {
-                        update_translate_ = true;
+                        panel.dirty = true;
                       });
     }
 
     duration += 0.35f;
     field_timeline_->add([this]() noexcept
                          {
-                           field_panels_.clear();
-                           field_panel_indices_.clear();
+                           clearFieldPanels();
                            field_rotate_offset_ = 0.0f;
                            field_timeline_->removeSelf();
                          },
@@ -806,6 +964,15 @@ public:
     panel_disp_ = false;
   }
 
+  // この後使うパネルを先に読み込む
+  void prefetchPanels(const std::vector<int>& numbers) noexcept
+  {
+    for (auto number : numbers)
+    {
+      panel_streamer_.request(panel_path[number], ModelStreamer::NEXT);
+    }
+  }
+
   const ci::AxisAlignedBox& panelAabb(int number) const noexcept
   {
     return panel_aabb_;
@@ -820,6 +987,9 @@ public:
   // フィールド表示
   void drawField(const Info& info) noexcept
   {
+    PROFILE_SCOPE("View::drawField");
+
+    updateFieldPanels();
     updateFieldBlank();
 
     ci::gl::enableDepth();
@@ -905,6 +1075,7 @@ public:
   void setFieldSpecular(const ci::ColorA& color) noexcept
   {
     field_shader_->uniform("uSpecular", color);
+    panel_shader_->uniform("uSpecular", color);
     blank_shader_->uniform("uSpecular", color);
     effect_shader_->uniform("uSpecular", color);
   }
@@ -912,6 +1083,7 @@ public:
   void setFieldShininess(float shininess) noexcept
   {
     field_shader_->uniform("uShininess", shininess);
+    panel_shader_->uniform("uShininess", shininess);
     blank_shader_->uniform("uShininess", shininess);
     effect_shader_->uniform("uShininess", shininess);
   }
@@ -919,6 +1091,7 @@ public:
   void setFieldAmbient(float value) noexcept
   {
     field_shader_->uniform("uAmbient", value);
+    panel_shader_->uniform("uAmbient", value);
     blank_shader_->uniform("uAmbient", value);
     effect_shader_->uniform("uAmbient", value);
   }
@@ -951,6 +1124,7 @@ public:
     for (auto& panel : field_panels_)
     {
       panel.top_y = scale;
+      panel.dirty = true;
     }
   }
 
@@ -958,29 +1132,138 @@ public:
 
 
 private:
-  // 読まれてないパネルを読み込む
+  // 読み込みが終わっていなければ急がせて、代わりのモデルを返す
   const ci::gl::BatchRef& getPanelModel(int number) noexcept
   {
     if (!panel_models[number])
     {
       const auto& path = panel_path[number];
-      if (!panel_model_cache_.count(path))
+      auto it = panel_model_cache_.find(path);
+      if (it == std::end(panel_model_cache_))
       {
-        auto tri_mesh = Model::load(path);
-
-        // panel_aabb[number] = tri_mesh.calcBoundingBox();
-        auto mesh = ci::gl::Batch::create(tri_mesh, field_shader_);
-        panel_models[number] = mesh;
-        panel_model_cache_.insert({ path, mesh });
+        panel_streamer_.request(path, ModelStreamer::NOW);
+        return placeholder_model_;
       }
-      else
+      panel_models[number] = it->second;
+    }
+
+    return panel_models[number];
+  }
+
+  // 読み込みが終わったパネルをGPUへ転送する
+  void receivePanelModels() noexcept
+  {
+    panel_streamer_.update([this](const std::string& path, const Model::MeshBuffer& buffer) noexcept
+                           {
+                             // NOTICE 手持ちのパネルは常に一番詳細なLODで表示
+                             auto meshes = Model::createVboMeshes(buffer);
+                             panel_model_cache_.insert({ path, ci::gl::Batch::create(meshes[0], field_shader_) });
+                             panel_model_lods_.insert({ path, meshes });
+                             panel_model_aabb_.insert({ path, buffer.aabb });
+
+                             auto it = panel_group_cache_.find(path);
+                             if (it == std::end(panel_group_cache_)) return;
+
+                             // 代わりのモデルで表示していたパネルを差し替える
+                             auto group = it->second;
+                             setupPanelGroup(panel_groups_[group], meshes, buffer.aabb);
+                             for (auto& p : field_panels_)
+                             {
+                               if (p.group == group) p.dirty = true;
+                             }
+                             shadow_cache_valid_ = false;
+                           });
+  }
+
+  // パネルのインスタンシング用の描画単位
+  // TIPS 同じパスのモデルは同じ単位にまとめる
+  int getPanelGroup(int number) noexcept
+  {
+    auto& index = panel_group_index_[number];
+    if (index < 0)
+    {
+      const auto& path = panel_path[number];
+      auto it = panel_group_cache_.find(path);
+      if (it == std::end(panel_group_cache_))
       {
-        DOUT << "Use cache: " << path << std::endl;
-        panel_models[number] = panel_model_cache_.at(path);
+        // TIPS 読み込み中なら代わりのモデルで作り、読み込み後に差し替える
+        panel_groups_.emplace_back();
+        auto lods = panel_model_lods_.find(path);
+        if (lods != std::end(panel_model_lods_))
+        {
+          setupPanelGroup(panel_groups_.back(), lods->second, panel_model_aabb_.at(path));
+        }
+        else
+        {
+          panel_streamer_.request(path, ModelStreamer::NOW);
+          setupPanelGroup(panel_groups_.back(), { placeholder_mesh_ }, panel_aabb_);
+        }
+        it = panel_group_cache_.insert({ path, int(panel_groups_.size() - 1) }).first;
       }
+      index = it->second;
     }
 
-    return panel_models[number];
+    return index;
+  }
+
+  // 頂点データは共有し、インスタンス毎の属性を追加したVboMeshを作る
+  //   meshes: LODごとのメッシュ(0が最も詳細)
+  void setupPanelGroup(PanelGroup& group, const std::vector<ci::gl::VboMeshRef>& meshes, const ci::AxisAlignedBox& aabb) noexcept
+  {
+    ci::geom::BufferLayout layout;
+    layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(PanelInstance), offsetof(PanelInstance, matrix), 1 /* per instance */);
+    layout.append(ci::geom::Attrib::CUSTOM_1, 1, sizeof(PanelInstance), offsetof(PanelInstance, diffuse_power), 1 /* per instance */);
+    layout.append(ci::geom::Attrib::CUSTOM_2, 1, sizeof(PanelInstance), offsetof(PanelInstance, top_y), 1 /* per instance */);
+
+    group.lods.clear();
+    for (const auto& mesh : meshes)
+    {
+      group.lods.emplace_back(PANEL_INSTANCE_NUM);
+      auto& lod = group.lods.back();
+      lod.model = ci::gl::Batch::create(createInstancedMesh(mesh, layout, lod.instances.vbo()), panel_shader_,
+                                        {
+                                          { ci::geom::Attrib::CUSTOM_0, "vInstanceMatrix" },
+                                          { ci::geom::Attrib::CUSTOM_1, "vInstanceDiffusePower" },
+                                          { ci::geom::Attrib::CUSTOM_2, "vInstanceTopY" },
+                                          });
+    }
+    group.shadow.model = ci::gl::Batch::create(createInstancedMesh(meshes.back(), layout, group.shadow.instances.vbo()), panel_shadow_shader_,
+                                               {
+                                                 { ci::geom::Attrib::CUSTOM_0, "vInstanceMatrix" },
+                                                 { ci::geom::Attrib::CUSTOM_2, "vInstanceTopY" },
+                                                 });
+
+    // TIPS 完成演出でY>2の部分がOutBackで少し伸びるので余裕を持たせる
+    auto max_pos = aabb.getMax();
+    max_pos.y = std::max(max_pos.y, (max_pos.y - 2.0f) * 1.2f + 2.0f);
+    group.aabb = ci::AxisAlignedBox(aabb.getMin(), max_pos);
+  }
+
+  void setupCloudGroup(CloudGroup& group, const ci::gl::VboMeshRef& mesh) noexcept
+  {
+    ci::geom::BufferLayout layout;
+    layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(glm::mat4), 0, 1 /* per instance */);
+
+    group.model = ci::gl::Batch::create(createInstancedMesh(mesh, layout, group.instances.vbo()), cloud_shader_,
+                                        {
+                                          { ci::geom::Attrib::CUSTOM_0, "vInstanceMatrix" },
+                                          });
+    group.shadow_model = ci::gl::Batch::create(createInstancedMesh(mesh, layout, group.shadow_instances.vbo()), cloud_shader_,
+                                               {
+                                                 { ci::geom::Attrib::CUSTOM_0, "vInstanceMatrix" },
+                                                 });
+  }
+
+  // 頂点データを共有し、インスタンス毎の属性だけ追加したVboMeshを作る
+  //   パスごとにインスタンスが違うので元のVboMeshには追加しない
+  static ci::gl::VboMeshRef createInstancedMesh(const ci::gl::VboMeshRef& mesh,
+                                                const ci::geom::BufferLayout& layout,
+                                                const ci::gl::VboRef& instance_vbo) noexcept
+  {
+    auto buffers = mesh->getVertexArrayLayoutVbos();
+    buffers.push_back({ layout, instance_vbo });
+    return ci::gl::VboMesh::create(mesh->getNumVertices(), mesh->getGlPrimitive(), buffers,
+                                   mesh->getNumIndices(), mesh->getIndexDataType(), mesh->getIndexVbo());
   }
 
 
@@ -1041,6 +1324,8 @@ private:
     ;
 
     shadow_map_ = ci::gl::Texture2d::create(fbo_size.x, fbo_size.y, depthFormat);
+    // NOTICE 深度の複製は同じ形式同士でしかできない
+    auto cache_map = ci::gl::Texture2d::create(fbo_size.x, fbo_size.y, depthFormat);
 
     try
     {
@@ -1049,6 +1334,12 @@ private:
                .disableColor()
       ;
       shadow_fbo_ = ci::gl::Fbo::create(fbo_size.x, fbo_size.y, fboFormat);
+
+      ci::gl::Fbo::Format cacheFormat;
+      cacheFormat.attachment(GL_DEPTH_ATTACHMENT, cache_map)
+                 .disableColor()
+      ;
+      shadow_cache_fbo_ = ci::gl::Fbo::create(fbo_size.x, fbo_size.y, cacheFormat);
     }
     catch (const std::exception& e)
     {
@@ -1085,23 +1376,75 @@ private:
   }
 
   // 影のレンダリング
+  //   止まっているパネルはキャッシュに描いておき、毎フレームそれを複製して動くものだけ描き足す
+  //   TIPS 光源(カメラの注視点に追従)が動いている間はキャッシュを使わずに全て描く
+  //        透視投影なので平行移動しても影はずらせず、毎フレーム作り直すと複製の分だけ遅くなる
   void renderShadow(const Info& info) noexcept
   {
+    PROFILE_SCOPE("renderShadow");
+
     // Set polygon offset to battle shadow acne
     ci::gl::enable(GL_POLYGON_OFFSET_FILL);
     glPolygonOffset(polygon_offset_.x, polygon_offset_.y);
 
-    // Render scene to fbo from the view of the light
-    ci::gl::ScopedFramebuffer fbo(shadow_fbo_);
     ci::gl::ScopedViewport viewport(glm::vec2(), shadow_fbo_->getSize());
-    ci::gl::clear(GL_DEPTH_BUFFER_BIT);
     ci::gl::setMatrices(light_camera_);
+    ci::Frustum frustum(light_camera_);
+
+    auto light_matrix = light_camera_.getProjectionMatrix() * light_camera_.getViewMatrix();
+    bool light_moving = light_matrix != shadow_cache_matrix_;
+    if (light_moving)
+    {
+      shadow_cache_matrix_ = light_matrix;
+      shadow_cache_valid_  = false;
+    }
+
+    if (!light_moving && !shadow_cache_valid_)
+    {
+      PROFILE_SCOPE("renderShadowCache");
+
+      ci::gl::ScopedFramebuffer fbo(shadow_cache_fbo_);
+      ci::gl::clear(GL_DEPTH_BUFFER_BIT);
+      ci::gl::ScopedGlslProg prog(shadow_shader_);
+      drawFieldPanelShadow(frustum,
+                           [](const Panel& p) noexcept
+                           {
+                             return !p.moving;
+                           });
+
+      shadow_cache_valid_ = true;
+    }
+
+    if (!light_moving)
+    {
+      ci::Area area(glm::ivec2(), shadow_fbo_->getSize());
+      shadow_cache_fbo_->blitTo(shadow_fbo_, area, area, GL_NEAREST, GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Render scene to fbo from the view of the light
+    ci::gl::ScopedFramebuffer fbo(shadow_fbo_);
 
     {
       ci::gl::ScopedGlslProg prog(shadow_shader_);
 
-      drawFieldPanelShadow();
-      drawFieldBlankShadow();
+      if (light_moving)
+      {
+        ci::gl::clear(GL_DEPTH_BUFFER_BIT);
+        drawFieldPanelShadow(frustum,
+                             [](const Panel&) noexcept
+                             {
+                               return true;
+                             });
+      }
+      else if (!moving_panels_.empty())
+      {
+        drawFieldPanelShadow(frustum,
+                             [](const Panel& p) noexcept
+                             {
+                               return p.moving;
+                             });
+      }
+      drawFieldBlankShadow(frustum);
 
       if (panel_disp_)
       {
@@ -1117,7 +1460,7 @@ private:
     if (disp_cloud_shadow_)
 #endif
     {
-      drawClouds();
+      drawClouds(frustum, true);
     }
 
     // Disable polygon offset for final render
@@ -1127,10 +1470,14 @@ private:
   // Field描画
   void renderField(const Info& info) noexcept
   {
+    PROFILE_SCOPE("renderField");
+
     ci::gl::setMatrices(*info.main_camera);
+    ci::Frustum frustum(*info.main_camera);
 
     auto mat = light_camera_.getProjectionMatrix() * light_camera_.getViewMatrix();
     field_shader_->uniform("uShadowMatrix", mat);
+    panel_shader_->uniform("uShadowMatrix", mat);
     blank_shader_->uniform("uShadowMatrix", mat);
     bg_shader_->uniform("uShadowMatrix", mat);
 
@@ -1140,6 +1487,7 @@ private:
       auto v = info.main_camera->getViewMatrix() * glm::vec4(lp, 1);
 
       field_shader_->uniform("uLightPosition", v);
+      panel_shader_->uniform("uLightPosition", v);
       blank_shader_->uniform("uLightPosition", v);
       bg_shader_->uniform("uLightPosition", v);
       effect_shader_->uniform("uLightPosition", v);
@@ -1148,8 +1496,8 @@ private:
     ci::gl::ScopedGlslProg prog(field_shader_);
     ci::gl::ScopedTextureBind texScope(shadow_map_);
 
-    drawFieldPanels();
-    drawFieldBlank();
+    drawFieldPanels(frustum, *info.main_camera);
+    drawFieldBlank(frustum);
 
     if (panel_disp_)
     {
@@ -1178,7 +1526,7 @@ private:
     }
 
     drawFieldBg(info.bg_pos);
-    drawEffect();
+    drawEffect(frustum);
 
     if (disp_cloud_)
     {
@@ -1186,7 +1534,7 @@ private:
       ci::gl::disable(GL_CULL_FACE);
       ci::gl::enableAlphaBlending();
 
-      drawClouds();
+      drawClouds(frustum, false);
     }
   }
 
@@ -1209,73 +1557,214 @@ private:
     model->draw();
   }
 
-  // Fieldのパネルを全て表示
-  void drawFieldPanelShadow() noexcept
+  // 変化したパネルだけ行列とAABBを計算する
+  void updateFieldPanels() noexcept
   {
-    ci::gl::ScopedModelMatrix m;
+    std::vector<size_t> moving;
+    for (size_t i = 0; i < field_panels_.size(); ++i)
+    {
+      auto& p = field_panels_[i];
+      // Pause演出中は全パネルが回転する
+      p.moving = p.dirty || update_translate_;
+      if (!p.moving) continue;
+
+      moving.push_back(i);
+      updateFieldPanelMatrix(p);
+      p.aabb  = panel_groups_[p.group].aabb.transformed(p.matrix);
+      p.dirty = false;
 
-    for (const auto& p : field_panels_)
+      field_grid_.at(calcGridBlock(p.field_pos)).dirty = true;
+    }
+    update_translate_ = false;
+
+    // 動いているパネルが入れ替わったら影のキャッシュを作り直す
+    if (moving != moving_panels_)
     {
-      ci::gl::setModelMatrix(p.matrix);
+      moving_panels_.swap(moving);
+      shadow_cache_valid_ = false;
+    }
 
-      shadow_shader_->uniform("uTopY", p.top_y);
+    for (auto& it : field_grid_)
+    {
+      auto& block = it.second;
+      if (!block.dirty) continue;
 
-      const auto& model = getPanelModel(p.index);
-      ci::gl::draw(model->getVboMesh());
+      block.aabb = field_panels_[block.panels.front()].aabb;
+      for (auto index : block.panels)
+      {
+        block.aabb.include(field_panels_[index].aabb);
+      }
+      block.dirty = false;
     }
   }
 
-  void drawFieldPanels() noexcept
+  // パスごとの描画単位を全て処理
+  //   shadow: 影は1つ、描画はLODごと
+  template <typename F>
+  static void forEachPanelBatch(PanelGroup& group, bool shadow, F func) noexcept
   {
-    ci::gl::ScopedModelMatrix m;
+    if (shadow)
+    {
+      func(group.shadow);
+      return;
+    }
+
+    for (auto& lod : group.lods)
+    {
+      func(lod);
+    }
+  }
+
+  // 画面上の大きさからLODを選ぶ
+  // NOTICE 事前にsetupPanelLod()で距離の閾値を計算しておく
+  PanelBatch& selectPanelLod(PanelGroup& group, const Panel& p) const noexcept
+  {
+    auto d = p.position - lod_eye_;
+    auto distance2 = glm::dot(d, d);
+
+    int lod = 0;
+    while ((lod + 1) < int(group.lods.size())
+           && lod < panel_lod_distance2_.length()
+           && distance2 > panel_lod_distance2_[lod])
+    {
+      ++lod;
+    }
+    return group.lods[lod];
+  }
+
+  // パネルの見た目の高さ(pixel)がpanel_lod_size_を下回る距離を求めておく
+  //   h = PANEL_SIZE * viewport_h / (2 * d * tan(fov / 2))
+  void setupPanelLod(const ci::CameraPersp& camera) noexcept
+  {
+    lod_eye_ = camera.getEyePoint();
+
+    auto viewport_h = float(ci::gl::getViewport().second.y);
+    auto k = PANEL_SIZE * viewport_h / (2.0f * std::tan(glm::radians(camera.getFov()) * 0.5f));
+    for (int i = 0; i < panel_lod_size_.length(); ++i)
+    {
+      auto d = k / panel_lod_size_[i];
+      panel_lod_distance2_[i] = d * d;
+    }
+  }
+
+  // 視錐台に入っているパネルだけをモデルごとに詰めて転送
+  //   shadow: 影用の描画単位へ詰める(falseならLODを選ぶ)
+  //   pred:   対象のパネルを選ぶ
+  template <typename Pred>
+  void cullFieldPanels(const ci::Frustum& frustum, bool shadow, Pred pred) noexcept
+  {
+    for (auto& group : panel_groups_)
+    {
+      forEachPanelBatch(group, shadow,
+                        [](PanelBatch& batch) noexcept
+                        {
+                          batch.num = 0;
+                        });
+    }
+
+    for (const auto& it : field_grid_)
+    {
+      const auto& block = it.second;
+      if (!frustum.intersects(block.aabb)) continue;
+
+      // 区画が丸ごと入っていれば1枚ずつ調べなくて良い
+      bool inside = frustum.contains(block.aabb);
+      for (auto index : block.panels)
+      {
+        const auto& p = field_panels_[index];
+        if (!pred(p)) continue;
+        if (!inside && !frustum.intersects(p.aabb)) continue;
+
+        auto& group = panel_groups_[p.group];
+        auto& batch = shadow ? group.shadow
+                             : selectPanelLod(group, p);
+        batch.instances.store(batch.num, { p.matrix, p.diffuse_power, p.top_y });
+        ++batch.num;
+      }
+    }
 
-    for (const auto& p : field_panels_)
+    for (auto& group : panel_groups_)
     {
-      ci::gl::setModelMatrix(p.matrix);
+      forEachPanelBatch(group, shadow,
+                        [](PanelBatch& batch) noexcept
+                        {
+                          batch.instances.resize(batch.num);
+                          batch.instances.upload();
+                        });
+    }
+  }
 
-      field_shader_->uniform("uDiffusePower", p.diffuse_power);
-      field_shader_->uniform("uTopY", p.top_y);
+  // Fieldのパネルを全て表示
+  template <typename Pred>
+  void drawFieldPanelShadow(const ci::Frustum& frustum, Pred pred) noexcept
+  {
+    cullFieldPanels(frustum, true, pred);
 
-      const auto& model = getPanelModel(p.index);
-      model->draw();
+    for (const auto& group : panel_groups_)
+    {
+      if (group.shadow.instances.empty()) continue;
+      group.shadow.model->drawInstanced(int(group.shadow.instances.size()));
+    }
+  }
+
+  void drawFieldPanels(const ci::Frustum& frustum, const ci::CameraPersp& camera) noexcept
+  {
+    setupPanelLod(camera);
+    cullFieldPanels(frustum, false,
+                    [](const Panel&) noexcept
+                    {
+                      return true;
+                    });
+
+    for (const auto& group : panel_groups_)
+    {
+      for (const auto& lod : group.lods)
+      {
+        if (lod.instances.empty()) continue;
+        lod.model->drawInstanced(int(lod.instances.size()));
+      }
     }
   }
   
-  // Fieldの置ける場所をすべて表示
+  // Fieldの置ける場所の明滅
   void updateFieldBlank()
   {
     if (blank_panels_.empty()) return;
 
-    auto* mat = (glm::mat4*)blank_matrix_->mapReplace();
-    auto* diffuse_power = (float*)blank_diffuse_power_->mapReplace();
-
     auto t = float(put_gauge_timer_ * blank_effect_speed_);
+    blank_shader_->uniform("uTime", t);
+  }
+
+  // 視錐台に入っているBlankだけを詰めて転送
+  void cullFieldBlank(const ci::Frustum& frustum, InstanceBuffer<glm::mat4>& instances) noexcept
+  {
+    size_t num = 0;
     for (const auto& p : blank_panels_)
     {
-      float diffuse = glm::clamp(std::sin(t + p.position.x * blank_effect_.x + p.position.z * blank_effect_.y), 0.0f, 1.0f) * blank_diffuse_.x
-                      + blank_diffuse_.y;
-      *diffuse_power = diffuse;
-      ++diffuse_power;
+      if (!frustum.intersects(blank_aabb_.transformed(p.matrix))) continue;
 
-      *mat = p.matrix;
-      ++mat;
+      instances.store(num, p.matrix);
+      ++num;
     }
-    blank_matrix_->unmap();
-    blank_diffuse_power_->unmap();
+    instances.resize(num);
+    instances.upload();
   }
 
-
-  void drawFieldBlankShadow()
+  void drawFieldBlankShadow(const ci::Frustum& frustum) noexcept
   {
-    if (blank_panels_.empty()) return;
+    cullFieldBlank(frustum, *blank_shadow_instances_);
+    if (blank_shadow_instances_->empty()) return;
+
     shadow_shader_->uniform("uTopY", 1.0f);
-    blank_shadow_model_->drawInstanced(int(blank_panels_.size()));
+    blank_shadow_model_->drawInstanced(int(blank_shadow_instances_->size()));
   }
 
-  void drawFieldBlank() const
+  void drawFieldBlank(const ci::Frustum& frustum) noexcept
   {
-    if (blank_panels_.empty()) return;
-    blank_model_->drawInstanced(int(blank_panels_.size()));
+    cullFieldBlank(frustum, *blank_instances_);
+    if (blank_instances_->empty()) return;
+
+    blank_model_->drawInstanced(int(blank_instances_->size()));
   }
 
   // 置けそうな箇所をハイライト
@@ -1313,69 +1802,158 @@ private:
     bg_model->draw();
   }
 
-  // 演出表示
-  void drawEffect() noexcept
+  // 演出の時間を進める
+  //   終了したものは末尾と入れ替えて詰める
+  void updateEffect(double delta_time) noexcept
   {
-    auto* mat = (glm::mat4*)effect_matrix_->mapReplace();
-    auto* color = (ci::Color*)effect_color_->mapReplace();
-    int num = 0;
-    for (auto it = std::begin(effects_); it != std::end(effects_); )
+    auto& pool = effect_pool_;
+    auto dt = float(delta_time);
+    for (size_t i = 0; i < pool.num; ++i)
     {
-      if (!it->active)
+      pool.time[i] += dt;
+    }
+
+    for (size_t i = 0; i < pool.num; )
+    {
+      if (pool.time[i] < pool.duration[i])
       {
-        it = effects_.erase(it);
+        ++i;
         continue;
       }
 
-      if (it->disp)
-      {
-        *color = it->color;
-        ++color;
-
-        *mat = glm::translate(it->pos) * glm::scale(it->scale);
-        ++mat;
-
-        ++num;
-      }
+      auto last = --pool.num;
+      pool.time[i]     = pool.time[last];
+      pool.duration[i] = pool.duration[last];
+      pool.x[i]        = pool.x[last];
+      pool.z[i]        = pool.z[last];
+      pool.start_y[i]  = pool.start_y[last];
+      pool.move_y[i]   = pool.move_y[last];
+      pool.scale[i]    = pool.scale[last];
+      pool.color[i]    = pool.color[last];
+    }
+  }
 
-      ++it;
+  // 演出表示
+  void drawEffect(const ci::Frustum& frustum) noexcept
+  {
+    auto& pool = effect_pool_;
+    for (size_t i = 0; i < pool.num; ++i)
+    {
+      pool.rate[i] = glm::clamp(pool.time[i] / pool.duration[i], 0.0f, 1.0f);
+    }
+    for (size_t i = 0; i < pool.num; ++i)
+    {
+      pool.rate[i] = effect_ease_func_(pool.rate[i]);
     }
-    effect_matrix_->unmap();
-    effect_color_->unmap();
 
+    auto& instances = *effect_instances_;
+    const auto& aabb_min = effect_aabb_.getMin();
+    const auto& aabb_max = effect_aabb_.getMax();
+    size_t num = 0;
+    for (size_t i = 0; i < pool.num; ++i)
+    {
+      // 開始待ち
+      if (pool.time[i] < 0.0f) continue;
+
+      glm::vec3 pos{ pool.x[i], pool.start_y[i] + pool.move_y[i] * pool.rate[i], pool.z[i] };
+      auto s = pool.scale[i];
+      if (!frustum.intersects(ci::AxisAlignedBox(pos + aabb_min * s, pos + aabb_max * s))) continue;
+
+      // 移動と拡大縮小だけなので直接作る
+      glm::mat4 matrix(s);
+      matrix[3] = glm::vec4(pos, 1.0f);
+      instances.store(num, { matrix, pool.color[i] });
+      ++num;
+    }
+    instances.resize(num);
     if (!num) return;
 
-    effect_model_->drawInstanced(num);
+    instances.upload();
+    effect_model_->drawInstanced(int(num));
   }
 
   // 雲
-  void updateClouds(double delta_time)
+  // TIPS 数が少ないのでワーカーに回すと受け渡しの方が高くつく
+  void updateClouds(double delta_time) noexcept
   {
-    for (auto& c : clouds_)
+    auto dt  = float(delta_time);
+    auto num = cloud_x_.size();
+
+    moveClouds(cloud_x_.data(), cloud_vx_.data(), num, dt, cloud_area_);
+    moveClouds(cloud_z_.data(), cloud_vz_.data(), num, dt, cloud_area_);
+    for (size_t i = 0; i < num; ++i)
     {
-      auto& pos = c.first;
-      pos += c.second * float(delta_time);
+      cloud_y_[i] += cloud_vy_[i] * dt;
+    }
+
+    calcCloudMatrix();
+  }
 
-      if (pos.x >  cloud_area_) pos.x -= cloud_area_ * 2;
-      if (pos.x < -cloud_area_) pos.x += cloud_area_ * 2;
-      if (pos.z >  cloud_area_) pos.z -= cloud_area_ * 2;
-      if (pos.z < -cloud_area_) pos.z += cloud_area_ * 2;
+  // 1軸分の移動と範囲外の折り返し
+  //   分岐を使わずに書いてコンパイラのベクトル化に任せる
+  static void moveClouds(float* __restrict pos, const float* __restrict vel, size_t num, float dt, float area) noexcept
+  {
+    auto width = area * 2.0f;
+    for (size_t i = 0; i < num; ++i)
+    {
+      float p = pos[i] + vel[i] * dt;
+      p -= float(p >  area) * width;
+      p += float(p < -area) * width;
+      pos[i] = p;
     }
   }
 
-  void drawClouds() const
+  // 影と本描画で共通の行列を事前計算
+  // TIPS 移動と拡大縮小だけなので直接作る
+  void calcCloudMatrix() noexcept
   {
-    ci::gl::ScopedGlslProg prog(cloud_shader_);
-    ci::gl::ScopedTextureBind tex(cloud_texture_);
-    ci::gl::ScopedModelMatrix m;
+    cloud_matrix_.resize(cloud_x_.size());
+    for (size_t i = 0; i < cloud_x_.size(); ++i)
+    {
+      auto& m = cloud_matrix_[i];
+      m = glm::mat4(1.0f);
+      m[0][0] = cloud_scale_.x;
+      m[1][1] = cloud_scale_.y;
+      m[2][2] = cloud_scale_.z;
+      m[3]    = glm::vec4(cloud_x_[i], cloud_y_[i], cloud_z_[i], 1.0f);
+    }
+  }
+
+  // 視錐台に入っている雲をモデルごとに詰めて、まとめて描画
+  void drawClouds(const ci::Frustum& frustum, bool shadow)
+  {
+    for (auto& group : cloud_groups_)
+    {
+      group.num = 0;
+    }
+
+    for (size_t i = 0; i < cloud_matrix_.size(); ++i)
+    {
+      auto& group = cloud_groups_[i % cloud_groups_.size()];
 
-    size_t i = 0;
-    for (const auto& c : clouds_)
+      glm::vec3 pos(cloud_matrix_[i][3]);
+      ci::AxisAlignedBox aabb(pos + group.aabb.getMin() * cloud_scale_,
+                              pos + group.aabb.getMax() * cloud_scale_);
+      if (!frustum.intersects(aabb)) continue;
+
+      auto& instances = shadow ? group.shadow_instances
+                               : group.instances;
+      instances.store(group.num, cloud_matrix_[i]);
+      ++group.num;
+    }
+
+    ci::gl::ScopedTextureBind tex(cloud_texture_);
+    for (auto& group : cloud_groups_)
     {
-      auto mtx = glm::translate(c.first) * glm::scale(cloud_scale_);
-      ci::gl::setModelMatrix(mtx);
-      ci::gl::draw(cloud_models_[i % cloud_models_.size()]);
-      ++i;
+      auto& instances = shadow ? group.shadow_instances
+                               : group.instances;
+      instances.resize(group.num);
+      if (!group.num) continue;
+
+      instances.upload();
+      auto& model = shadow ? group.shadow_model
+                           : group.model;
+      model->drawInstanced(int(group.num));
     }
   }
 
@@ -1392,6 +1970,7 @@ private:
     auto dir   = glm::normalize(Json::getVec<glm::vec3>(params["cloud_dir"]));
     auto speed = Json::getVec<glm::vec2>(params["cloud_speed"]);
 
+    std::vector<std::pair<glm::vec3, glm::vec3>> clouds;
     auto num = params.getValueForKey<int>("cloud_num");
     for (int i = 0; i < num; ++i)
     {
@@ -1402,22 +1981,22 @@ private:
       };
       auto v = dir * randFromVec2(speed);
 
-      clouds_.push_back({ p, v });
+      clouds.push_back({ p, v });
     }
 
     // 総当たりで相互の距離を調整する
-    for (int i = 0; i < clouds_.size(); ++i)
+    for (int i = 0; i < clouds.size(); ++i)
     {
-      const auto& p1  = clouds_[i].first;
+      const auto& p1  = clouds[i].first;
       const auto& bc1 = bounding_circle[i % cloud_kinds];
       auto pos1 = p1 + bc1.first;
       float r1  = bc1.second;
 
-      for (int j = 0; j < clouds_.size(); ++j)
+      for (int j = 0; j < clouds.size(); ++j)
       {
         if (i == j) continue;
 
-        auto& p2  = clouds_[j].first;
+        auto& p2  = clouds[j].first;
         const auto& bc2 = bounding_circle[j % cloud_kinds];
         auto pos2 = p2 + bc2.first;
         float r2  = bc2.second;
@@ -1441,6 +2020,17 @@ private:
         }
       }
     }
+
+    // 更新しやすいように軸ごとに並べ直す
+    for (const auto& c : clouds)
+    {
+      cloud_x_.push_back(c.first.x);
+      cloud_y_.push_back(c.first.y);
+      cloud_z_.push_back(c.first.z);
+      cloud_vx_.push_back(c.second.x);
+      cloud_vy_.push_back(c.second.y);
+      cloud_vz_.push_back(c.second.z);
+    }
   }
 
 
@@ -1449,14 +2039,39 @@ private:
   std::vector<ci::gl::BatchRef> panel_models;
   // NOTE 同じパスのモデルデータのキャッシュ
   std::map<std::string, ci::gl::BatchRef> panel_model_cache_;
+  std::map<std::string, ci::AxisAlignedBox> panel_model_aabb_;
+  std::map<std::string, std::vector<ci::gl::VboMeshRef>> panel_model_lods_;
+
+  // インスタンシング用
+  ci::gl::GlslProgRef panel_shader_;
+  ci::gl::GlslProgRef panel_shadow_shader_;
+  // NOTICE InstanceBufferはコピーできないのでstd::vectorではない
+  std::deque<PanelGroup> panel_groups_;
+  // パネル番号→panel_groups_の添字(-1:未作成)
+  std::vector<int> panel_group_index_;
+  std::map<std::string, int> panel_group_cache_;
+
+  // LOD切り替えの見た目の高さ(pixel)と、それに対応する距離の2乗
+  glm::vec2 panel_lod_size_;
+  glm::vec2 panel_lod_distance2_;
+  glm::vec3 lod_eye_;
+
+  // 裏での読み込み
+  ModelStreamer panel_streamer_;
+  ci::gl::VboMeshRef placeholder_mesh_;
+  ci::gl::BatchRef placeholder_model_;
+
+  // カリング用の空間インデックス
+  std::map<glm::ivec2, GridBlock, LessVec<glm::ivec2>> field_grid_;
 
   // AABBは全パネル共通
   ci::AxisAlignedBox panel_aabb_;
 
   // 演出用
   ci::gl::GlslProgRef blank_shader_;
-  ci::gl::VboRef blank_matrix_;
-  ci::gl::VboRef blank_diffuse_power_;
+  std::unique_ptr<InstanceBuffer<glm::mat4>> blank_instances_;
+  std::unique_ptr<InstanceBuffer<glm::mat4>> blank_shadow_instances_;
+  ci::AxisAlignedBox blank_aabb_;
   ci::gl::BatchRef blank_model_;
 
   ci::gl::GlslProgRef blank_shadow_shader_;
@@ -1500,8 +2115,8 @@ private:
   // 得点時演出用
   ci::gl::GlslProgRef effect_shader_;
   ci::gl::BatchRef effect_model_;
-  ci::gl::VboRef effect_matrix_;
-  ci::gl::VboRef effect_color_;
+  std::unique_ptr<InstanceBuffer<EffectInstance>> effect_instances_;
+  ci::AxisAlignedBox effect_aabb_;
 
   glm::vec2 effect_y_ofs_;
   glm::vec2 effect_y_move_;
@@ -1516,6 +2131,13 @@ private:
   ci::gl::Texture2dRef shadow_map_;
   ci::gl::FboRef shadow_fbo_;
 
+  // 止まっているパネルだけの影
+  ci::gl::FboRef shadow_cache_fbo_;
+  bool shadow_cache_valid_ = false;
+  glm::mat4 shadow_cache_matrix_;
+  // 動いているパネル(field_panels_の添字)
+  std::vector<size_t> moving_panels_;
+
   glm::vec2 polygon_offset_;
 
   ci::CameraPersp light_camera_;
@@ -1576,16 +2198,24 @@ private:
   // パネルを置くゲージ演出
   double put_gauge_timer_ = 0.0;
 
-  // FIXME 途中の削除が多いのでvectorは向いていない??
-  std::list<Effect> effects_;
+  EffectPool effect_pool_;
+  ci::EaseFn effect_ease_func_;
 
   // 雲演出
   bool clouds_active_ = true;
   int clouds_active_counter_ = 0;
-  std::vector<ci::gl::VboMeshRef> cloud_models_;
+  // NOTICE InstanceBufferはコピーできないのでstd::vectorではない
+  std::deque<CloudGroup> cloud_groups_;
   ci::gl::Texture2dRef cloud_texture_;
   ci::gl::GlslProgRef cloud_shader_;
-  std::vector<std::pair<glm::vec3, glm::vec3>> clouds_;
+  // 位置と速度(SoA)
+  std::vector<float> cloud_x_;
+  std::vector<float> cloud_y_;
+  std::vector<float> cloud_z_;
+  std::vector<float> cloud_vx_;
+  std::vector<float> cloud_vy_;
+  std::vector<float> cloud_vz_;
+  std::vector<glm::mat4> cloud_matrix_;
   glm::vec3 cloud_scale_;
   float cloud_area_;
   ci::ColorA cloud_color_;
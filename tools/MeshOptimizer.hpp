@@ -0,0 +1,427 @@
+﻿#pragma once
+
+//
+// パネル用メッシュの最適化(meshconvから使う)
+//
+//   LOD0 そのまま(ボクセルの面ごとに中心点を持つ4枚の三角形)
+//   LOD1 中心点を省いて面ごとに2枚の三角形
+//   LOD2 同じ平面で同じ色の面を長方形にまとめる
+//
+//   どのLODも形は同じなので、影はLOD2で描いても変わらない
+//   頂点は全LODで共有し、頂点キャッシュに合わせて三角形を並べ替える
+//
+
+#include <vector>
+#include <map>
+#include <array>
+#include <tuple>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "../src/PLYParser.hpp"
+
+
+namespace MeshOptimizer {
+
+using Mesh   = ngs::PLY::Mesh;
+using Vertex = ngs::MeshFormat::Vertex;
+
+
+// ボクセルの面
+struct Quad
+{
+  // 外周の頂点(面の表から見て反時計回り)
+  std::array<uint32_t, 4> corners;
+  uint32_t center;
+};
+
+// MagicaVoxelが書き出した面(中心点を共有する4枚の三角形)を探す
+//   quads:  見つかった面
+//   others: それ以外の三角形
+inline void findQuads(const std::vector<uint32_t>& indices,
+                      std::vector<Quad>& quads, std::vector<uint32_t>& others)
+{
+  size_t i = 0;
+  while (i < indices.size())
+  {
+    bool found = (i + 12 <= indices.size());
+    for (size_t j = 0; found && j < 4; ++j)
+    {
+      const auto* t    = &indices[i + j * 3];
+      const auto* next = &indices[i + ((j + 1) % 4) * 3];
+      found = (t[0] == indices[i]) && (t[2] == next[1]);
+    }
+
+    if (found)
+    {
+      quads.push_back({ { indices[i + 1], indices[i + 4], indices[i + 7], indices[i + 10] }, indices[i] });
+      i += 12;
+    }
+    else
+    {
+      others.insert(std::end(others), std::begin(indices) + i, std::begin(indices) + i + 3);
+      i += 3;
+    }
+  }
+}
+
+
+inline bool sameColor(const Vertex& a, const Vertex& b)
+{
+  return std::memcmp(a.color, b.color, sizeof(a.color)) == 0;
+}
+
+// 同じ平面にある同じ色の面を長方形にまとめる(Greedy meshing)
+//   まとめられない面は2枚の三角形にする
+//   NOTICE 隣の面との間にT字の接続ができる
+inline std::vector<uint32_t> mergeQuads(const Mesh& mesh, const std::vector<Quad>& quads)
+{
+  std::vector<uint32_t> indices;
+
+  // 平面 (法線の軸, 向き, 平面の座標) ごとに分ける
+  using Plane = std::tuple<int, bool, long>;
+  struct Cell
+  {
+    size_t quad;
+    // (u, v) が (最小, 最小) (最大, 最小) (最大, 最大) (最小, 最大) の頂点
+    std::array<uint32_t, 4> corners;
+  };
+  std::map<Plane, std::map<std::pair<long, long>, Cell>> planes;
+
+  auto emitQuad = [&indices](const std::array<uint32_t, 4>& c)
+                  {
+                    indices.insert(std::end(indices), { c[0], c[1], c[2], c[0], c[2], c[3] });
+                  };
+
+  for (size_t i = 0; i < quads.size(); ++i)
+  {
+    const auto& q = quads[i];
+    const auto& center = mesh.vertices[q.center];
+
+    // 色が一様な面だけまとめる
+    bool uniform = true;
+    for (auto c : q.corners)
+    {
+      uniform = uniform && sameColor(mesh.vertices[c], center);
+    }
+
+    // 法線の軸
+    const auto* p0 = mesh.vertices[q.corners[0]].position;
+    const auto* p1 = mesh.vertices[q.corners[1]].position;
+    const auto* p2 = mesh.vertices[q.corners[2]].position;
+    float e0[] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e1[] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    float n[] = {
+      e0[1] * e1[2] - e0[2] * e1[1],
+      e0[2] * e1[0] - e0[0] * e1[2],
+      e0[0] * e1[1] - e0[1] * e1[0]
+    };
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+      if (std::abs(n[j]) > std::abs(n[axis])) axis = j;
+    }
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+
+    // 座標は0.5単位なので2倍して整数で扱う
+    auto grid = [](float value)
+                {
+                  return long(std::lround(value * 2.0f));
+                };
+
+    // 軸に沿った1×1の正方形か
+    long min_u = grid(p0[u]);
+    long max_u = min_u;
+    long min_v = grid(p0[v]);
+    long max_v = min_v;
+    bool aligned = true;
+    for (auto c : q.corners)
+    {
+      const auto* p = mesh.vertices[c].position;
+      aligned = aligned && (grid(p[axis]) == grid(p0[axis]));
+      min_u = std::min(min_u, grid(p[u]));
+      max_u = std::max(max_u, grid(p[u]));
+      min_v = std::min(min_v, grid(p[v]));
+      max_v = std::max(max_v, grid(p[v]));
+    }
+    aligned = aligned && (max_u - min_u == 2) && (max_v - min_v == 2);
+
+    if (!uniform || !aligned)
+    {
+      emitQuad(q.corners);
+      continue;
+    }
+
+    Cell cell{ i, { } };
+    for (auto c : q.corners)
+    {
+      const auto* p = mesh.vertices[c].position;
+      bool is_max_u = grid(p[u]) == max_u;
+      bool is_max_v = grid(p[v]) == max_v;
+      static const int tbl[2][2] = { { 0, 3 }, { 1, 2 } };
+      cell.corners[tbl[is_max_u][is_max_v]] = c;
+    }
+
+    Plane plane{ axis, n[axis] > 0.0f, grid(p0[axis]) };
+    planes[plane].insert({ { min_v / 2, min_u / 2 }, cell });
+  }
+
+  for (auto& it : planes)
+  {
+    bool positive = std::get<1>(it.first);
+    auto& cells = it.second;
+
+    auto match = [&cells, &mesh](long v, long u, const Vertex& color) -> Cell*
+                 {
+                   auto found = cells.find({ v, u });
+                   if (found == std::end(cells)) return nullptr;
+                   if (!sameColor(mesh.vertices[found->second.corners[0]], color)) return nullptr;
+                   return &found->second;
+                 };
+
+    // TIPS mapなので (v, u) の順に走査される
+    while (!cells.empty())
+    {
+      auto begin = std::begin(cells);
+      long v0 = begin->first.first;
+      long u0 = begin->first.second;
+      const auto color = mesh.vertices[begin->second.corners[0]];
+
+      // 横に伸ばす
+      long w = 1;
+      while (match(v0, u0 + w, color)) ++w;
+
+      // 縦に伸ばす
+      long h = 1;
+      while (true)
+      {
+        bool ok = true;
+        for (long x = 0; ok && x < w; ++x)
+        {
+          ok = match(v0 + h, u0 + x, color) != nullptr;
+        }
+        if (!ok) break;
+        ++h;
+      }
+
+      std::array<uint32_t, 4> c{
+        cells.at({ v0,         u0         }).corners[0],
+        cells.at({ v0,         u0 + w - 1 }).corners[1],
+        cells.at({ v0 + h - 1, u0 + w - 1 }).corners[2],
+        cells.at({ v0 + h - 1, u0         }).corners[3]
+      };
+      // (u, v, 法線の軸)が右手系なので、法線が負なら裏返す
+      if (!positive) std::swap(c[1], c[3]);
+      emitQuad(c);
+
+      for (long y = 0; y < h; ++y)
+      {
+        for (long x = 0; x < w; ++x)
+        {
+          cells.erase({ v0 + y, u0 + x });
+        }
+      }
+    }
+  }
+
+  return indices;
+}
+
+
+// 頂点キャッシュ最適化(Tom Forsyth "Linear-Speed Vertex Cache Optimisation")
+inline std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_num)
+{
+  enum { CACHE_SIZE = 32 };
+
+  auto tri_num = indices.size() / 3;
+
+  // 頂点ごとの未出力の三角形
+  std::vector<uint32_t> remain(vertex_num, 0);
+  for (auto i : indices) ++remain[i];
+
+  std::vector<uint32_t> offsets(vertex_num + 1, 0);
+  for (size_t i = 0; i < vertex_num; ++i) offsets[i + 1] = offsets[i] + remain[i];
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    auto fill = offsets;
+    for (size_t t = 0; t < tri_num; ++t)
+    {
+      for (int j = 0; j < 3; ++j) adjacency[fill[indices[t * 3 + j]]++] = uint32_t(t);
+    }
+  }
+
+  std::vector<int> cache_pos(vertex_num, -1);
+  auto vertexScore = [&](uint32_t v)
+                     {
+                       if (!remain[v]) return -1.0f;
+
+                       float score = 0.0f;
+                       int pos = cache_pos[v];
+                       if (pos >= 0)
+                       {
+                         // 直前の三角形の頂点は少し下げる
+                         score = (pos < 3) ? 0.75f
+                                           : std::pow(1.0f - float(pos - 3) / (CACHE_SIZE - 3), 1.5f);
+                       }
+                       // 残りが少ない頂点を優先して片付ける
+                       return score + 2.0f * std::pow(float(remain[v]), -0.5f);
+                     };
+
+  std::vector<float> vertex_score(vertex_num);
+  for (uint32_t v = 0; v < vertex_num; ++v) vertex_score[v] = vertexScore(v);
+
+  std::vector<bool> emitted(tri_num, false);
+  std::vector<float> tri_score(tri_num);
+  for (size_t t = 0; t < tri_num; ++t)
+  {
+    tri_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<uint32_t> cache;
+  size_t scan = 0;
+
+  auto best = size_t(-1);
+  for (size_t n = 0; n < tri_num; ++n)
+  {
+    if (best == size_t(-1))
+    {
+      // キャッシュから見つからなければ未出力のものを先頭から
+      while (emitted[scan]) ++scan;
+      best = scan;
+    }
+
+    emitted[best] = true;
+    std::vector<uint32_t> next_cache;
+    for (int j = 0; j < 3; ++j)
+    {
+      auto v = indices[best * 3 + j];
+      result.push_back(v);
+      next_cache.push_back(v);
+
+      // 隣接リストから取り除く
+      auto* top = &adjacency[offsets[v]];
+      auto* end = top + remain[v];
+      std::remove(top, end, uint32_t(best));
+      --remain[v];
+    }
+    for (auto v : cache)
+    {
+      if (std::find(std::begin(next_cache), std::end(next_cache), v) == std::end(next_cache)) next_cache.push_back(v);
+    }
+
+    // キャッシュから溢れた頂点
+    for (size_t i = CACHE_SIZE; i < next_cache.size(); ++i)
+    {
+      cache_pos[next_cache[i]] = -1;
+      vertex_score[next_cache[i]] = vertexScore(next_cache[i]);
+    }
+    if (next_cache.size() > CACHE_SIZE) next_cache.resize(CACHE_SIZE);
+    cache.swap(next_cache);
+
+    // キャッシュ内の頂点と、それに接する三角形のスコアを更新
+    for (size_t i = 0; i < cache.size(); ++i)
+    {
+      cache_pos[cache[i]] = int(i);
+      vertex_score[cache[i]] = vertexScore(cache[i]);
+    }
+
+    best = size_t(-1);
+    float best_score = -1.0f;
+    for (auto v : cache)
+    {
+      for (uint32_t k = 0; k < remain[v]; ++k)
+      {
+        auto t = adjacency[offsets[v] + k];
+        tri_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+        if (tri_score[t] > best_score)
+        {
+          best_score = tri_score[t];
+          best = t;
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+// 三角形あたりの頂点シェーダーの実行回数(FIFOキャッシュで計算)
+inline float calcAcmr(const std::vector<uint32_t>& indices, size_t cache_size = 16)
+{
+  if (indices.empty()) return 0.0f;
+
+  std::vector<uint32_t> cache;
+  size_t miss = 0;
+  for (auto i : indices)
+  {
+    if (std::find(std::begin(cache), std::end(cache), i) != std::end(cache)) continue;
+
+    ++miss;
+    cache.push_back(i);
+    if (cache.size() > cache_size) cache.erase(std::begin(cache));
+  }
+
+  return float(miss) / float(indices.size() / 3);
+}
+
+// LOD0で最初に使う順に頂点を並べ替える(使われない頂点は取り除く)
+inline void reorderVertices(Mesh& mesh, std::vector<std::vector<uint32_t>>& lods)
+{
+  std::vector<uint32_t> remap(mesh.vertices.size(), uint32_t(-1));
+  std::vector<Vertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (const auto& indices : lods)
+  {
+    for (auto i : indices)
+    {
+      if (remap[i] != uint32_t(-1)) continue;
+
+      remap[i] = uint32_t(vertices.size());
+      vertices.push_back(mesh.vertices[i]);
+    }
+  }
+
+  for (auto& indices : lods)
+  {
+    for (auto& i : indices)
+    {
+      i = remap[i];
+    }
+  }
+  mesh.vertices.swap(vertices);
+}
+
+
+// LODを作る
+inline std::vector<std::vector<uint32_t>> buildLods(const Mesh& mesh)
+{
+  std::vector<Quad> quads;
+  std::vector<uint32_t> others;
+  findQuads(mesh.indices, quads, others);
+
+  std::vector<std::vector<uint32_t>> lods(3);
+  lods[0] = mesh.indices;
+
+  // 中心点を省く
+  for (const auto& q : quads)
+  {
+    const auto& c = q.corners;
+    lods[1].insert(std::end(lods[1]), { c[0], c[1], c[2], c[0], c[2], c[3] });
+  }
+  lods[1].insert(std::end(lods[1]), std::begin(others), std::end(others));
+
+  lods[2] = mergeQuads(mesh, quads);
+  lods[2].insert(std::end(lods[2]), std::begin(others), std::end(others));
+
+  for (auto& indices : lods)
+  {
+    indices = optimizeVertexCache(indices, mesh.vertices.size());
+  }
+
+  return lods;
+}
+
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+
+# 性能計測
+#   閾値を超えると終了コードが1になる
+#   NOTICE 実行ファイルはvc2017かxcodeでビルドしたもの
+#          GLのウィンドウを開くので、画面の無い環境では動かない
+#
+#   ./benchmark.sh <実行ファイル> [スクリプト]
+
+if [ $# -lt 1 ]; then
+  echo "usage: benchmark.sh <app> [script]"
+  exit 1
+fi
+
+APP=$1
+SCRIPT=${2:-$(dirname "$0")/benchmark.json}
+
+"$APP" --benchmark "$SCRIPT"
@@ -0,0 +1,233 @@
+//
+// 難読化(圧縮)したデータを作るやつ & 圧縮方法の比較
+//   形式は src/Codec.hpp
+//   LZ4とzstdはNGS_USE_LZ4/NGS_USE_ZSTDを定義してビルドした時だけ使える
+//
+//   codec encode <params|archive|record> input output
+//   codec decode input output
+//   codec bench files...
+//     圧縮済みのファイル(セーブデータなど)は展開してから比較する
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <iterator>
+#include "../src/Codec.hpp"
+
+
+namespace Codec = ngs::Codec;
+
+
+std::string readFile(const std::string& path)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+}
+
+bool writeFile(const std::string& path, const std::string& data)
+{
+  std::ofstream fstr(path, std::ios::binary);
+  fstr.write(data.data(), data.size());
+  return bool(fstr);
+}
+
+// 以前の形式(zlibのストリームのみ)
+bool inflateLegacy(const std::string& input, std::string& output)
+{
+  z_stream z{ };
+  inflateInit(&z);
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
+  z.avail_in = uInt(input.size());
+
+  output.resize(input.size() * 4 + 1024);
+  int status;
+  do
+  {
+    if (z.total_out == output.size()) output.resize(output.size() * 2);
+    z.next_out  = reinterpret_cast<Bytef*>(&output[z.total_out]);
+    z.avail_out = uInt(output.size() - z.total_out);
+    status = inflate(&z, Z_NO_FLUSH);
+  }
+  while (status == Z_OK);
+
+  output.resize(z.total_out);
+  inflateEnd(&z);
+  return status == Z_STREAM_END;
+}
+
+// 圧縮されていれば展開して読む
+std::string loadPlain(const std::string& path)
+{
+  auto data = readFile(path);
+
+  std::string output;
+  if (const auto* header = Codec::getHeader(data.data(), data.size()))
+  {
+    if (Codec::decompress(*header, data.size(), output)) return output;
+  }
+  else if (inflateLegacy(data, output))
+  {
+    return output;
+  }
+
+  return data;
+}
+
+
+int encode(const std::string& usage, const std::string& input, const std::string& output)
+{
+  static const std::map<std::string, Codec::Usage> usages{
+    { "params",  Codec::Usage::PARAMS },
+    { "archive", Codec::Usage::ARCHIVE },
+    { "record",  Codec::Usage::GAME_RECORD },
+  };
+  if (!usages.count(usage))
+  {
+    std::cout << "Unknown usage:" << usage << std::endl;
+    return 1;
+  }
+
+  auto data = readFile(input);
+  auto method = Codec::getMethod(usages.at(usage));
+  auto encoded = Codec::compress(data.data(), data.size(), method);
+  if (encoded.empty())
+  {
+    std::cout << "Encode error:" << input << std::endl;
+    return 1;
+  }
+  if (!writeFile(output, encoded))
+  {
+    std::cout << "File write error:" << output << std::endl;
+    return 1;
+  }
+  std::cout << input << " " << data.size() << " -> " << encoded.size() << " (" << method.type << method.level << ")" << std::endl;
+
+  return 0;
+}
+
+int decode(const std::string& input, const std::string& output)
+{
+  if (!writeFile(output, loadPlain(input)))
+  {
+    std::cout << "File write error:" << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+
+// 0.2秒以上繰り返して1回あたりの時間を求める
+template <typename F>
+double measure(F func)
+{
+  using Clock = std::chrono::steady_clock;
+
+  int count = 0;
+  auto start = Clock::now();
+  std::chrono::duration<double> elapsed;
+  do
+  {
+    func();
+    ++count;
+    elapsed = Clock::now() - start;
+  }
+  while (elapsed.count() < 0.2);
+
+  return elapsed.count() / count;
+}
+
+int bench(const std::vector<std::string>& paths)
+{
+  std::vector<std::string> corpus;
+  size_t total = 0;
+  for (const auto& path : paths)
+  {
+    corpus.push_back(loadPlain(path));
+    total += corpus.back().size();
+  }
+  std::cout << corpus.size() << " files, " << total << " bytes.\n" << std::endl;
+
+  const std::vector<Codec::Method> methods{
+    { Codec::STORE, 0 },
+    { Codec::ZLIB,  Z_BEST_SPEED },
+    { Codec::ZLIB,  Z_DEFAULT_COMPRESSION },
+    { Codec::ZLIB,  Z_BEST_COMPRESSION },
+    { Codec::LZ4,   0 },
+    { Codec::LZ4,   12 },
+    { Codec::ZSTD,  1 },
+    { Codec::ZSTD,  19 },
+  };
+
+  std::cout << "method     ratio   encode MB/s  decode MB/s" << std::endl;
+  for (const auto& method : methods)
+  {
+    if (!Codec::isAvailable(method.type)) continue;
+
+    std::vector<std::string> encoded(corpus.size());
+    auto encode_time = measure([&]()
+                               {
+                                 for (size_t i = 0; i < corpus.size(); ++i)
+                                 {
+                                   encoded[i] = Codec::compress(corpus[i].data(), corpus[i].size(), method);
+                                 }
+                               });
+
+    size_t encoded_size = 0;
+    for (const auto& e : encoded)
+    {
+      encoded_size += e.size();
+    }
+
+    bool valid = true;
+    std::string decoded;
+    auto decode_time = measure([&]()
+                               {
+                                 for (size_t i = 0; i < encoded.size(); ++i)
+                                 {
+                                   const auto* header = Codec::getHeader(encoded[i].data(), encoded[i].size());
+                                   valid = valid && header && Codec::decompress(*header, encoded[i].size(), decoded)
+                                           && decoded == corpus[i];
+                                 }
+                               });
+
+    double mb = total / (1024.0 * 1024.0);
+    std::cout << method.type << std::setw(3) << method.level
+              << std::fixed << std::setprecision(3)
+              << std::setw(12) << double(encoded_size) / total
+              << std::setprecision(1)
+              << std::setw(13) << mb / encode_time
+              << std::setw(13) << mb / decode_time
+              << (valid ? "" : "  DECODE ERROR") << std::endl;
+  }
+
+  return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string mode = (argc > 1) ? argv[1] : "";
+
+  if (mode == "encode" && argc == 5)
+  {
+    return encode(argv[2], argv[3], argv[4]);
+  }
+  if (mode == "decode" && argc == 4)
+  {
+    return decode(argv[2], argv[3]);
+  }
+  if (mode == "bench" && argc > 2)
+  {
+    return bench({ argv + 2, argv + argc });
+  }
+
+  std::cout << "usage: codec encode <params|archive|record> input output\n"
+               "       codec decode input output\n"
+               "       codec bench files..." << std::endl;
+  return 1;
+}
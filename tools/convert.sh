@@ -2,5 +2,9 @@
 
 cd ../tools
 
-./filedz ../assets/intro.json ../assets/intro.data
-./filedz ../assets/params.json ../assets/params.data
+./codec encode params ../assets/intro.json ../assets/intro.data
+(cd ../assets && ../tools/paramc params.bundle params.json settings.json tw_*.json ui_*.json)
+
+for f in ../assets/p*.ply; do
+  ./meshconv $f ${f%.ply}.bmesh
+done
@@ -1,15 +1,30 @@
 ﻿//
 // ファイルを１つにまとめるやつ
-//   圧縮はしません
+//   形式は src/PackFormat.hpp
+//   パックするファイルと圧縮方法はマニフェスト(pack.txt)で指定する
+//   前回のパックと中身が同じファイルはそのデータを使い回す
+//   全て同じなら書き出さない
+//
+//   pack <asset dir> <output> [manifest]
 //
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <map>
-#include <cassert>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <zlib.h>
 #include <boost/filesystem.hpp>
+#include "../src/PackFormat.hpp"
+#include "../src/AssetPack.hpp"
+
+
+namespace PackFormat = ngs::PackFormat;
 
 
 bool isHidden(const boost::filesystem::path& p)
@@ -25,210 +40,416 @@ bool isHidden(const boost::filesystem::path& p)
   return false;
 }
 
-// Packするファイルか??
-//  FIXME ハードコーディング
-bool isPack(const boost::filesystem::path& p)
+
+// マニフェスト
+//   1行に「拡張子かファイル名」と「圧縮方法(store/zlib)」
+//   #から行末まではコメント
+//   載っていないファイルはパックしない
+using Manifest = std::map<std::string, PackFormat::Method>;
+
+bool loadManifest(const std::string& path, Manifest& manifest)
+{
+  std::ifstream fstr(path);
+  if (!fstr.is_open()) return false;
+
+  std::string line;
+  while (std::getline(fstr, line))
+  {
+    line = line.substr(0, line.find('#'));
+
+    std::istringstream sstr(line);
+    std::string name;
+    std::string method;
+    if (!(sstr >> name)) continue;
+    if (!(sstr >> method))
+    {
+      std::cout << "No method: " << name << std::endl;
+      return false;
+    }
+
+    if (method == "store")
+    {
+      manifest[name] = PackFormat::STORE;
+    }
+    else if (method == "zlib")
+    {
+      manifest[name] = PackFormat::ZLIB;
+    }
+    else
+    {
+      std::cout << "Unknown method: " << method << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// ファイル名が優先
+// 戻り値:false パックしない
+bool findMethod(const Manifest& manifest, const boost::filesystem::path& p, PackFormat::Method& method)
 {
-  auto name = p.extension();
-  if (name == ".m4a"
-      || name == ".png"
-      || name == ".data")
+  auto it = manifest.find(p.filename().string());
+  if (it == std::end(manifest))
   {
-    return false;
+    it = manifest.find(p.extension().string());
+    if (it == std::end(manifest)) return false;
   }
-  
+
+  method = it->second;
   return true;
 }
 
 
-// FIXME ファイル上限4GB
-struct File
+enum
 {
-  boost::filesystem::path path;
-  // 先頭からのオフセット
-  uint32_t offset;
-  // データサイズ
-  uint32_t size;
+  // ファイルを読む単位
+  CHUNK_SIZE = 1024 * 64,
 };
 
-// ファイルに書き出す時は
-//
-//   header size 4
-//
-//   path size  4
-//   path       可変
-//   offset     4
-//   size       4
-//
-//   data
-//
-// とする
 
-uint32_t calcHeaderSize(const std::vector<File>& files)
+// FNV-1a
+uint64_t calcHash(uint64_t hash, const char* data, size_t size)
 {
-  uint32_t size = sizeof(uint32_t);
-  for (const auto& f : files)
+  for (size_t i = 0; i < size; ++i)
   {
-    size += sizeof(uint32_t) * 3;
-    size += f.path.filename().size();
+    hash ^= uint8_t(data[i]);
+    hash *= 1099511628211ull;
   }
-
-  return size;
+  return hash;
 }
 
-//
-// 実装
-//
-
-struct PackedFile
+// ファイルを少しずつ読む
+//   func(data, size)
+template <typename F>
+bool readChunks(const boost::filesystem::path& path, F func)
 {
-  struct Body
-  {
-    uint32_t offset;
-    uint32_t size;
-  };
+  std::ifstream fstr(path.string(), std::ios::binary);
+  if (!fstr.is_open()) return false;
 
-
-  PackedFile(const std::string& path)
-    : fstr_(path, std::ios::binary)
+  std::vector<char> buffer(CHUNK_SIZE);
+  while (fstr)
   {
-    // ファイル数
-    uint32_t file_num;
-    fstr_.read((char*)&file_num, sizeof(file_num));
+    fstr.read(buffer.data(), buffer.size());
+    auto size = size_t(fstr.gcount());
+    if (size) func(buffer.data(), size);
+  }
+  return fstr.eof();
+}
 
-    // ヘッダー解析
-    for (uint32_t i = 0; i < file_num; ++i)
-    {
-      uint32_t path_size;
-      fstr_.read((char*)&path_size, sizeof(path_size));
+// 全スレッドで分担して func(index) を実行する
+template <typename F>
+void parallelFor(size_t num, F func)
+{
+  std::atomic<size_t> next{ 0 };
+  auto worker = [&next, num, &func]()
+                {
+                  while (true)
+                  {
+                    auto i = next++;
+                    if (i >= num) break;
+                    func(i);
+                  }
+                };
+
+  std::vector<std::thread> threads(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  for (auto& t : threads)
+  {
+    t = std::thread(worker);
+  }
+  worker();
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+}
 
-      std::vector<char> path(path_size);
-      fstr_.read(&path[0], path_size);
 
-      uint32_t offset;
-      fstr_.read((char*)&offset, sizeof(offset));
+struct File
+{
+  boost::filesystem::path path;
+  std::string name;
+  PackFormat::Method method;
+  PackFormat::Entry entry;
 
-      uint32_t size;
-      fstr_.read((char*)&size, sizeof(size));
+  // 前回のパックのデータ(nullptr:使い回さない)
+  const char* reuse = nullptr;
+  // 圧縮したデータ(無圧縮なら書き出し時に元ファイルから読む)
+  std::vector<char> data;
 
-      Body body{ offset, size };
-      std::string filename{ std::begin(path), std::end(path) };
-      info_.insert({ filename, body });
+  bool error = false;
+};
 
-      std::cout << filename << std::endl;
-    }
+// 元ファイルのハッシュとCRC32を求め、前回と違えば圧縮する
+void processFile(File& f, const ngs::AssetPack* previous)
+{
+  auto& entry = f.entry;
+
+  uint64_t hash = 14695981039346656037ull;
+  uLong crc = crc32(0, Z_NULL, 0);
+  uint64_t size = 0;
+  if (!readChunks(f.path,
+                  [&](const char* data, size_t n)
+                  {
+                    hash = calcHash(hash, data, n);
+                    crc  = crc32(crc, reinterpret_cast<const Bytef*>(data), uInt(n));
+                    size += n;
+                  }))
+  {
+    f.error = true;
+    return;
   }
+  // TIPS 圧縮方法が変わった時も作り直す
+  hash = calcHash(hash, reinterpret_cast<const char*>(&f.method), sizeof(f.method));
 
-  std::vector<char> read(const std::string& path)
+  if (previous)
   {
-    if (!info_.count(path))
+    const auto* e = previous->find(f.name);
+    if (e && e->source_hash == hash && e->original_size == size)
     {
-      std::cout << "File not found: " << path << std::endl;
-      return std::vector<char>();
+      entry = *e;
+      f.reuse = previous->data(*e);
+      return;
     }
+  }
 
-    const auto& body = info_.at(path);
-    fstr_.seekg(body.offset);
-
-    std::vector<char> input(body.size);
-    fstr_.read(&input[0], input.size());
+  entry.source_hash   = hash;
+  entry.original_size = size;
+  entry.method        = PackFormat::STORE;
+  entry.size          = size;
+  entry.crc32         = uint32_t(crc);
+  if (f.method != PackFormat::ZLIB) return;
+
+  z_stream z{ };
+  deflateInit(&z, Z_BEST_COMPRESSION);
+
+  std::vector<char> output;
+  std::vector<Bytef> outbuf(CHUNK_SIZE);
+  auto deflateChunk = [&z, &output, &outbuf](const char* data, size_t n, int flush)
+                      {
+                        z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+                        z.avail_in = uInt(n);
+                        do
+                        {
+                          z.next_out  = outbuf.data();
+                          z.avail_out = uInt(outbuf.size());
+                          deflate(&z, flush);
+                          output.insert(std::end(output), outbuf.data(), z.next_out);
+                        }
+                        while (z.avail_out == 0);
+                      };
+  f.error = !readChunks(f.path,
+                        [&deflateChunk](const char* data, size_t n)
+                        {
+                          deflateChunk(data, n, Z_NO_FLUSH);
+                        });
+  deflateChunk(nullptr, 0, Z_FINISH);
+  deflateEnd(&z);
+
+  // 縮まなければ無圧縮のまま
+  if (output.size() >= size) return;
+
+  uLong output_crc = crc32(0, Z_NULL, 0);
+  output_crc = crc32(output_crc, reinterpret_cast<const Bytef*>(output.data()), uInt(output.size()));
+
+  entry.method = PackFormat::ZLIB;
+  entry.size   = output.size();
+  entry.crc32  = uint32_t(output_crc);
+  f.data = std::move(output);
+}
 
-    return input;
+// データを1つ書き出す
+bool writeFile(std::ofstream& file, const File& f)
+{
+  if (f.reuse)
+  {
+    file.write(f.reuse, f.entry.size);
+  }
+  else if (!f.data.empty())
+  {
+    file.write(f.data.data(), f.data.size());
+  }
+  else
+  {
+    // 無圧縮のものは元ファイルから直接
+    uint64_t size = 0;
+    if (!readChunks(f.path,
+                    [&file, &size](const char* data, size_t n)
+                    {
+                      file.write(data, n);
+                      size += n;
+                    }))
+    {
+      return false;
+    }
+    // 処理中に書き換えられた
+    if (size != f.entry.size) return false;
   }
 
-
-private:
-  // TIPS ファイルは開きっぱなし
-  std::ifstream fstr_;
-  std::map<std::string, Body> info_;
-};
+  return bool(file);
+}
 
 
 int main(int argc, char* argv[])
 {
+  if (argc < 3)
+  {
+    std::cout << "usage: pack <asset dir> <output> [manifest]" << std::endl;
+    return 1;
+  }
+
   boost::filesystem::path p(argv[1]);
+  boost::filesystem::path output(argv[2]);
+
+  Manifest manifest;
+  std::string manifest_path = (argc > 3) ? argv[3] : "pack.txt";
+  if (!loadManifest(manifest_path, manifest))
+  {
+    std::cout << "Manifest read error:" << manifest_path << std::endl;
+    return 1;
+  }
 
   std::vector<File> files;
 
   // ファイル情報収拾
   for (boost::filesystem::directory_entry& x : boost::filesystem::directory_iterator(p))
   {
-    if (!isHidden(x.path()) && isPack(x.path()))
+    PackFormat::Method method;
+    if (isHidden(x.path())
+        || !boost::filesystem::is_regular_file(x.path())
+        || !findMethod(manifest, x.path(), method))
     {
-      files.push_back({
-          x.path(),
-          0,
-          uint32_t(boost::filesystem::file_size(x.path())) });
-
-      std::cout << x.path().filename() << std::endl;
+      continue;
     }
+
+    File f;
+    f.path   = x.path();
+    f.name   = x.path().filename().string();
+    f.method = method;
+    files.push_back(std::move(f));
   }
+  // TIPS 読み込み側は二分探索するので名前順に並べておく
+  std::sort(std::begin(files), std::end(files),
+            [](const File& a, const File& b)
+            {
+              return a.name < b.name;
+            });
   std::cout << files.size() << " files." << std::endl;
 
+  // 前回のパック
+  std::unique_ptr<ngs::AssetPack> previous;
+  if (boost::filesystem::is_regular_file(output))
+  {
+    previous = std::make_unique<ngs::AssetPack>(output.string());
+    if (previous->empty()) previous.reset();
+  }
+
+  parallelFor(files.size(),
+              [&files, &previous](size_t i)
+              {
+                processFile(files[i], previous.get());
+              });
+
+  size_t reused = 0;
+  for (const auto& f : files)
+  {
+    if (f.error)
+    {
+      std::cout << "File read error:" << f.path << std::endl;
+      return 1;
+    }
+    if (f.reuse)
+    {
+      ++reused;
+      continue;
+    }
+    std::cout << f.name << " " << f.entry.original_size << " -> " << f.entry.size << std::endl;
+  }
+
+  if (previous && reused == files.size() && previous->size() == files.size())
+  {
+    std::cout << "Up to date." << std::endl;
+    return 0;
+  }
+
   // ヘッダ情報確定
-  auto header_size = calcHeaderSize(files);
-  auto offset = header_size;
+  uint64_t names_size = 0;
   for (auto& f : files)
   {
-    f.offset = offset;
-    offset += f.size;
+    f.entry.name_offset = uint32_t(names_size);
+    f.entry.name_size   = uint32_t(f.name.size());
+    names_size += f.name.size();
   }
 
+  auto offset = PackFormat::align(PackFormat::calcIndexSize(files.size(), names_size));
+  for (auto& f : files)
+  {
+    f.entry.offset = offset;
+    offset = PackFormat::align(offset + f.entry.size);
+  }
 
+  // TIPS 前回のパックを読みながら書くので別名で書き出して置き換える
+  auto temp_path = output;
+  temp_path += ".tmp";
   {
-    std::fstream file(argv[2], std::ios::binary | std::ios::out);
+    std::ofstream file(temp_path.string(), std::ios::binary);
 
     // ヘッダ書き出し
-    uint32_t num = files.size();
-    file.write((char*)&num, sizeof(num));
+    PackFormat::Header header{ };
+    std::memcpy(header.magic, PackFormat::MAGIC, sizeof(header.magic));
+    header.version    = PackFormat::VERSION;
+    header.entry_num  = files.size();
+    header.names_size = names_size;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
     for (const auto& f : files)
     {
-      uint32_t size = f.path.filename().size();
-      file.write((char*)&size, sizeof(size));
-      file.write(f.path.filename().string().c_str(), size);
-
-      file.write((char*)&f.offset, sizeof(f.offset));
-      file.write((char*)&f.size, sizeof(f.size));
+      file.write(reinterpret_cast<const char*>(&f.entry), sizeof(f.entry));
+    }
+    for (const auto& f : files)
+    {
+      file.write(f.name.data(), f.name.size());
     }
 
     // ファイル結合
+    // TIPS 各データはページ境界から置く
+    std::vector<char> padding(PackFormat::ALIGNMENT);
     for (const auto& f : files)
     {
-      std::ifstream fstr(f.path.string(), std::ios::binary);
-      if (!fstr.is_open())
+      file.write(padding.data(), f.entry.offset - uint64_t(file.tellp()));
+      if (!writeFile(file, f))
       {
-        std::cout << "File open error:" << f.path << std::endl;
-        return 0;
+        std::cout << "File write error:" << f.path << std::endl;
+        return 1;
       }
-
-      std::vector<char> input(f.size);
-      fstr.read(&input[0], input.size());
-      file.write(&input[0], input.size());
     }
   }
+  previous.reset();
+  boost::filesystem::rename(temp_path, output);
 
   // テスト
+  // 書き出したデータを全てCRC32で調べる(元ファイルは読み直さない)
   {
-    std::cout << "\nTest packed files.\n" << std::endl;
-
-    std::string path{ argv[2] };
-    PackedFile packed{ path };
+    ngs::AssetPack packed(output.string());
+    if (packed.size() != files.size())
+    {
+      std::cout << "Invalid pack." << std::endl;
+      return 1;
+    }
 
-    // 実際のファイルと比較する
-    for (boost::filesystem::directory_entry& x : boost::filesystem::directory_iterator(p))
+    for (const auto& f : files)
     {
-      if (!isHidden(x.path()) && isPack(x.path()))
+      const auto* entry = packed.find(f.name);
+      if (!entry
+          || entry->source_hash != f.entry.source_hash
+          || !packed.verify(*entry))
       {
-        std::vector<char> src(boost::filesystem::file_size(x.path()));
-        {
-          std::ifstream fstr(x.path().string(), std::ios::binary);
-          fstr.read(&src[0], src.size());
-        }
-        auto dst = packed.read(x.path().filename().string());
-
-        // TIPS std::vectorの比較
-        assert(src == dst);
+        std::cout << "Pack error: " << f.name << std::endl;
+        return 1;
       }
     }
   }
+  std::cout << reused << " reused, " << (files.size() - reused) << " packed." << std::endl;
+
+  return 0;
 }
@@ -0,0 +1,123 @@
+﻿//
+// MagicaVoxelから書き出したPLYを.bmeshに変換するやつ
+//   アプリ内の PLY::load(path, true) と同じ手順
+//   (法線計算→同じ頂点の削除→法線を少しずらす)で作り、
+//   LODの生成と頂点キャッシュ向けの並べ替えを行う(MeshOptimizer.hpp)
+//
+//   meshconv input.ply output.bmesh
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include "../src/MeshFormat.hpp"
+#include "../src/PLYParser.hpp"
+#include "MeshOptimizer.hpp"
+
+
+using Mesh = ngs::PLY::Mesh;
+
+
+bool loadPly(const std::string& path, Mesh& mesh)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  if (!fstr.is_open()) return false;
+
+  std::vector<char> data((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+  return ngs::PLY::parse(data.data(), data.size(), mesh);
+}
+
+
+void normalize(float* v)
+{
+  float l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (l == 0.0f) return;
+
+  v[0] /= l;
+  v[1] /= l;
+  v[2] /= l;
+}
+
+// ランダムな軸で±0.08rad回転
+void displaceNormals(Mesh& mesh)
+{
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<float> angle(-0.08f, 0.08f);
+  std::normal_distribution<float> axis;
+
+  for (auto& v : mesh.vertices)
+  {
+    float k[] = { axis(engine), axis(engine), axis(engine) };
+    normalize(k);
+    float r = angle(engine);
+
+    // ロドリゲスの回転公式
+    const auto* n = v.normal;
+    float c = std::cos(r);
+    float s = std::sin(r);
+    float d = (k[0] * n[0] + k[1] * n[1] + k[2] * n[2]) * (1.0f - c);
+    float kxn[] = {
+      k[1] * n[2] - k[2] * n[1],
+      k[2] * n[0] - k[0] * n[2],
+      k[0] * n[1] - k[1] * n[0]
+    };
+
+    float result[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      result[i] = n[i] * c + kxn[i] * s + k[i] * d;
+    }
+    std::memcpy(v.normal, result, sizeof(result));
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cout << "usage: meshconv input.ply output.bmesh" << std::endl;
+    return 1;
+  }
+
+  std::cout << argv[1] << std::endl;
+
+  Mesh mesh;
+  if (!loadPly(argv[1], mesh))
+  {
+    std::cout << "File read error:" << argv[1] << std::endl;
+    return 1;
+  }
+
+  ngs::PLY::calcNormals(mesh);
+  auto vertex_num = mesh.vertices.size();
+  ngs::PLY::weld(mesh);
+  std::cout << "  vtx: " << vertex_num << " -> " << mesh.vertices.size() << std::endl;
+  displaceNormals(mesh);
+
+  auto lods = MeshOptimizer::buildLods(mesh);
+  std::cout << "  ACMR: " << MeshOptimizer::calcAcmr(mesh.indices) << " -> " << MeshOptimizer::calcAcmr(lods[0]) << std::endl;
+  for (size_t i = 0; i < lods.size(); ++i)
+  {
+    std::cout << "  LOD" << i << ": " << lods[i].size() / 3 << " tris" << std::endl;
+  }
+  MeshOptimizer::reorderVertices(mesh, lods);
+
+  auto data = ngs::MeshFormat::encode(mesh.vertices, lods);
+  if (data.empty())
+  {
+    std::cout << "Too many vertices:" << mesh.vertices.size() << std::endl;
+    return 1;
+  }
+
+  std::ofstream ofs(argv[2], std::ios::binary);
+  ofs.write(data.data(), data.size());
+  std::cout << "  " << data.size() << " bytes." << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,562 @@
+//
+// パラメーターのJSONをまとめてバイナリにするやつ
+//   形式は src/ParamFormat.hpp
+//   JSONの書き間違いや、参照しているJSONが含まれていないのはここで弾く
+//   オブジェクトのキーはアプリ内のJSON読み込み(jsoncpp)と同じく名前順にする
+//
+//   paramc output.bundle input.json...
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <cstdlib>
+#include <cerrno>
+#include "../src/ParamFormat.hpp"
+
+
+namespace ParamFormat = ngs::ParamFormat;
+
+
+struct Value
+{
+  ParamFormat::Type type;
+
+  int64_t     i = 0;
+  uint64_t    u = 0;
+  double      d = 0.0;
+  std::string string;
+
+  // OBJECTはキーの順
+  std::vector<std::pair<std::string, Value>> children;
+};
+
+
+// 必要なだけのJSONパーサー
+class Parser
+{
+  const std::string& text_;
+  size_t pos_ = 0;
+
+
+  [[noreturn]] void error(const std::string& message) const
+  {
+    size_t line   = 1;
+    size_t column = 1;
+    for (size_t i = 0; i < pos_ && i < text_.size(); ++i)
+    {
+      if (text_[i] == '\n')
+      {
+        line  += 1;
+        column = 1;
+      }
+      else
+      {
+        column += 1;
+      }
+    }
+
+    std::ostringstream str;
+    str << line << ":" << column << ": " << message;
+    throw std::runtime_error(str.str());
+  }
+
+  void skipSpace()
+  {
+    while (pos_ < text_.size())
+    {
+      auto c = text_[pos_];
+      if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+      {
+        pos_ += 1;
+      }
+      else if (!text_.compare(pos_, 2, "//"))
+      {
+        // jsoncppはコメントを許している
+        pos_ = std::min(text_.find('\n', pos_), text_.size());
+      }
+      else if (!text_.compare(pos_, 2, "/*"))
+      {
+        auto end = text_.find("*/", pos_ + 2);
+        if (end == std::string::npos) error("unterminated comment");
+        pos_ = end + 2;
+      }
+      else
+      {
+        break;
+      }
+    }
+  }
+
+  char peek()
+  {
+    skipSpace();
+    if (pos_ == text_.size()) error("unexpected end");
+    return text_[pos_];
+  }
+
+  void expect(char c)
+  {
+    if (peek() != c) error(std::string("'") + c + "' expected");
+    pos_ += 1;
+  }
+
+  bool consume(const char* word)
+  {
+    auto len = std::strlen(word);
+    if (text_.compare(pos_, len, word)) return false;
+    pos_ += len;
+    return true;
+  }
+
+  static void appendUtf8(std::string& out, uint32_t c)
+  {
+    if (c < 0x80)
+    {
+      out += char(c);
+    }
+    else if (c < 0x800)
+    {
+      out += char(0xc0 | (c >> 6));
+      out += char(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+      out += char(0xe0 | (c >> 12));
+      out += char(0x80 | ((c >> 6) & 0x3f));
+      out += char(0x80 | (c & 0x3f));
+    }
+    else
+    {
+      out += char(0xf0 | (c >> 18));
+      out += char(0x80 | ((c >> 12) & 0x3f));
+      out += char(0x80 | ((c >> 6) & 0x3f));
+      out += char(0x80 | (c & 0x3f));
+    }
+  }
+
+  uint32_t parseHex4()
+  {
+    if (text_.size() - pos_ < 4) error("bad unicode escape");
+    uint32_t c = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      auto h = text_[pos_++];
+      c <<= 4;
+      if      (h >= '0' && h <= '9') c |= h - '0';
+      else if (h >= 'a' && h <= 'f') c |= h - 'a' + 10;
+      else if (h >= 'A' && h <= 'F') c |= h - 'A' + 10;
+      else error("bad unicode escape");
+    }
+    return c;
+  }
+
+  std::string parseString()
+  {
+    expect('"');
+    std::string out;
+    while (true)
+    {
+      if (pos_ == text_.size()) error("unterminated string");
+      auto c = text_[pos_++];
+      if (c == '"') break;
+      if (c != '\\')
+      {
+        out += c;
+        continue;
+      }
+
+      if (pos_ == text_.size()) error("unterminated string");
+      switch (text_[pos_++])
+      {
+      case '"':  out += '"';  break;
+      case '\\': out += '\\'; break;
+      case '/':  out += '/';  break;
+      case 'b':  out += '\b'; break;
+      case 'f':  out += '\f'; break;
+      case 'n':  out += '\n'; break;
+      case 'r':  out += '\r'; break;
+      case 't':  out += '\t'; break;
+      case 'u':
+        {
+          auto u = parseHex4();
+          if (u >= 0xd800 && u < 0xdc00)
+          {
+            // サロゲートペア
+            if (!consume("\\u")) error("bad surrogate pair");
+            auto low = parseHex4();
+            if (low < 0xdc00 || low >= 0xe000) error("bad surrogate pair");
+            u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00);
+          }
+          appendUtf8(out, u);
+        }
+        break;
+
+      default:
+        error("bad escape");
+      }
+    }
+    return out;
+  }
+
+  // TIPS jsoncppと同じく、小数点か指数があれば実数。整数はint64に収まらなければuint64
+  Value parseNumber()
+  {
+    auto start = pos_;
+    if (text_[pos_] == '-') pos_ += 1;
+    bool real = false;
+    while (pos_ < text_.size())
+    {
+      auto c = text_[pos_];
+      if (c == '.' || c == 'e' || c == 'E' || c == '+' || (c == '-' && pos_ > start))
+      {
+        real = true;
+      }
+      else if (c < '0' || c > '9')
+      {
+        break;
+      }
+      pos_ += 1;
+    }
+
+    auto token = text_.substr(start, pos_ - start);
+    if (token.empty() || token == "-") error("bad number");
+
+    Value value;
+    char* end;
+    errno = 0;
+    if (!real)
+    {
+      if (token[0] == '-')
+      {
+        value.type = ParamFormat::INT;
+        value.i    = std::strtoll(token.c_str(), &end, 10);
+      }
+      else
+      {
+        auto u = std::strtoull(token.c_str(), &end, 10);
+        if (u <= uint64_t(INT64_MAX))
+        {
+          value.type = ParamFormat::INT;
+          value.i    = int64_t(u);
+        }
+        else
+        {
+          value.type = ParamFormat::UINT;
+          value.u    = u;
+        }
+      }
+      if (*end == '\0' && errno == 0) return value;
+    }
+
+    // 整数で表せないものも実数にする
+    errno = 0;
+    value.type = ParamFormat::DOUBLE;
+    value.d    = std::strtod(token.c_str(), &end);
+    if (*end != '\0' || errno == ERANGE) error("bad number: " + token);
+    return value;
+  }
+
+  Value parseValue()
+  {
+    Value value;
+
+    auto c = peek();
+    if (c == '{')
+    {
+      value.type = ParamFormat::OBJECT;
+      pos_ += 1;
+
+      std::map<std::string, Value> members;
+      if (peek() != '}')
+      {
+        do
+        {
+          auto key = parseString();
+          expect(':');
+          if (!members.emplace(key, parseValue()).second) error("duplicate key: " + key);
+        }
+        while (peek() == ',' && ++pos_);
+      }
+      expect('}');
+
+      value.children.assign(std::begin(members), std::end(members));
+    }
+    else if (c == '[')
+    {
+      value.type = ParamFormat::ARRAY;
+      pos_ += 1;
+
+      if (peek() != ']')
+      {
+        do
+        {
+          value.children.push_back({ std::string(), parseValue() });
+        }
+        while (peek() == ',' && ++pos_);
+      }
+      expect(']');
+    }
+    else if (c == '"')
+    {
+      value.type   = ParamFormat::STRING;
+      value.string = parseString();
+    }
+    else if (consume("true"))
+    {
+      value.type = ParamFormat::BOOL;
+      value.i    = 1;
+    }
+    else if (consume("false"))
+    {
+      value.type = ParamFormat::BOOL;
+      value.i    = 0;
+    }
+    else if (!text_.compare(pos_, 4, "null"))
+    {
+      // NOTICE アプリ内では値として扱えない
+      error("null is not allowed");
+    }
+    else if (c == '-' || (c >= '0' && c <= '9'))
+    {
+      value = parseNumber();
+    }
+    else
+    {
+      error(std::string("unexpected '") + c + "'");
+    }
+
+    return value;
+  }
+
+
+public:
+  explicit Parser(const std::string& text)
+    : text_(text)
+  {
+    // UTF-8のBOM
+    if (!text_.compare(0, 3, "\xef\xbb\xbf")) pos_ = 3;
+  }
+
+  Value parse()
+  {
+    auto value = parseValue();
+    skipSpace();
+    if (pos_ != text_.size()) error("extra characters");
+    return value;
+  }
+};
+
+
+// バイナリへの変換
+class Writer
+{
+  std::vector<ParamFormat::File> files_;
+  std::vector<ParamFormat::Node> nodes_;
+  std::string strings_;
+  std::map<std::string, uint32_t> string_offsets_;
+
+
+  uint32_t addString(const std::string& str)
+  {
+    auto it = string_offsets_.find(str);
+    if (it != std::end(string_offsets_)) return it->second;
+
+    auto offset = uint32_t(strings_.size());
+    strings_.append(str.c_str(), str.size() + 1);
+    string_offsets_.insert({ str, offset });
+    return offset;
+  }
+
+  ParamFormat::Node makeNode(const std::string& key, const Value& value)
+  {
+    ParamFormat::Node node{ };
+    node.type = value.type;
+    node.key  = addString(key);
+
+    switch (value.type)
+    {
+    case ParamFormat::BOOL:
+    case ParamFormat::INT:
+      node.value.i = value.i;
+      break;
+
+    case ParamFormat::UINT:
+      node.value.u = value.u;
+      break;
+
+    case ParamFormat::DOUBLE:
+      node.value.d = value.d;
+      break;
+
+    case ParamFormat::STRING:
+      node.value.string = addString(value.string);
+      break;
+
+    default:
+      // 子供は後で
+      break;
+    }
+
+    return node;
+  }
+
+
+public:
+  Writer()
+  {
+    // 空文字列は先頭
+    addString("");
+  }
+
+  void add(const std::string& name, const Value& root)
+  {
+    files_.push_back({ addString(name), uint32_t(nodes_.size()) });
+
+    // TIPS 幅優先で並べると子供が連続する
+    std::deque<std::pair<uint32_t, const Value*>> queue;
+    nodes_.push_back(makeNode("", root));
+    queue.push_back({ uint32_t(nodes_.size() - 1), &root });
+    while (!queue.empty())
+    {
+      auto index = queue.front().first;
+      const auto* value = queue.front().second;
+      queue.pop_front();
+      if (value->type != ParamFormat::OBJECT && value->type != ParamFormat::ARRAY) continue;
+
+      auto first = uint32_t(nodes_.size());
+      for (const auto& child : value->children)
+      {
+        nodes_.push_back(makeNode(child.first, child.second));
+        queue.push_back({ uint32_t(nodes_.size() - 1), &child.second });
+      }
+      nodes_[index].value.children.first = first;
+      nodes_[index].value.children.num   = uint32_t(value->children.size());
+    }
+  }
+
+  std::string finish()
+  {
+    std::sort(std::begin(files_), std::end(files_),
+              [this](const ParamFormat::File& a, const ParamFormat::File& b)
+              {
+                return std::strcmp(&strings_[a.name], &strings_[b.name]) < 0;
+              });
+
+    ParamFormat::Header header{ };
+    std::memcpy(header.magic, ParamFormat::MAGIC, sizeof(ParamFormat::MAGIC));
+    header.version      = ParamFormat::VERSION;
+    header.file_num     = uint32_t(files_.size());
+    header.node_num     = uint32_t(nodes_.size());
+    header.strings_size = uint32_t(strings_.size());
+
+    std::string data;
+    data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char*>(files_.data()), sizeof(ParamFormat::File) * files_.size());
+    data.append(reinterpret_cast<const char*>(nodes_.data()), sizeof(ParamFormat::Node) * nodes_.size());
+    data.append(strings_);
+    return data;
+  }
+};
+
+
+std::string readFile(const std::string& path)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  if (!fstr) throw std::runtime_error("can't open");
+  return std::string((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+}
+
+std::string getFilename(const std::string& path)
+{
+  auto pos = path.find_last_of("/\\");
+  return (pos == std::string::npos) ? path : path.substr(pos + 1);
+}
+
+// 文字列で参照しているJSON(canvasやtweenなど)
+void collectReferences(const Value& value, const std::string& key, std::vector<std::string>& refs)
+{
+  if (value.type == ParamFormat::STRING)
+  {
+    const auto& s = value.string;
+    if (s.size() > 5 && !s.compare(s.size() - 5, 5, ".json")) refs.push_back(key + ": " + s);
+    return;
+  }
+
+  for (const auto& child : value.children)
+  {
+    collectReferences(child.second, key.empty() ? child.first : key + "." + child.first, refs);
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cout << "usage: paramc output.bundle input.json..." << std::endl;
+    return 1;
+  }
+
+  std::map<std::string, Value> files;
+  bool error = false;
+  for (int i = 2; i < argc; ++i)
+  {
+    auto name = getFilename(argv[i]);
+    try
+    {
+      auto text = readFile(argv[i]);
+      if (!files.emplace(name, Parser(text).parse()).second)
+      {
+        throw std::runtime_error("same name");
+      }
+    }
+    catch (std::exception& ex)
+    {
+      std::cout << argv[i] << ":" << ex.what() << std::endl;
+      error = true;
+    }
+  }
+
+  // 参照しているJSONが含まれているか
+  for (const auto& file : files)
+  {
+    std::vector<std::string> refs;
+    collectReferences(file.second, "", refs);
+    for (const auto& ref : refs)
+    {
+      auto name = ref.substr(ref.rfind(' ') + 1);
+      if (!files.count(name))
+      {
+        std::cout << file.first << ":" << ref << " not found." << std::endl;
+        error = true;
+      }
+    }
+  }
+  if (error) return 1;
+
+  Writer writer;
+  for (const auto& file : files)
+  {
+    writer.add(file.first, file.second);
+  }
+  auto data = writer.finish();
+
+  std::ofstream ofs(argv[1], std::ios::binary);
+  ofs.write(data.data(), data.size());
+  if (!ofs)
+  {
+    std::cout << "File write error:" << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::cout << files.size() << " files, " << data.size() << " bytes." << std::endl;
+  return 0;
+}
@@ -1,6 +1,10 @@
 #!/bin/sh
 
 cd ../assets
+mv ../warehouse/packed/* .
+# 生成物は残さない
+rm -f params.bundle
+mv assets.pack ../warehouse
 mv ../warehouse/Panels/p*.ply .
 mv ../warehouse/intro.json .
-mv ../warehouse/params.json .
+mv ../warehouse/params.json ../warehouse/settings.json ../warehouse/tw_*.json ../warehouse/ui_*.json .
@@ -1,8 +1,32 @@
 #!/bin/sh
 
 cd ../assets
-../tools/filedz intro.json intro.data
-../tools/filedz params.json params.data
+../tools/codec encode params intro.json intro.data
+# TIPS パラメーターはまとめてバイナリにする(JSONはパックに入れない)
+../tools/paramc params.bundle params.json settings.json tw_*.json ui_*.json || exit 1
 mv intro.json ../warehouse
-mv params.json ../warehouse
+mv params.json settings.json tw_*.json ui_*.json ../warehouse
 mv p*.ply ../warehouse/Panels
+
+# TIPS 前回から変わったファイルだけ作り直す(全て同じなら何もしない)
+#      パックはビルドの間だけassetsに置く(DEBUGビルドが古いデータを読まないように)
+[ -f ../warehouse/assets.pack ] && mv ../warehouse/assets.pack .
+if ! ../tools/conv . assets.pack ../tools/pack.txt; then
+  # NOTICE 失敗したらassetsを元に戻す(postbuild.shは実行されない)
+  #        作りかけのパックは次回最初から作り直す
+  rm -f assets.pack params.bundle
+  mv ../warehouse/Panels/p*.ply .
+  mv ../warehouse/intro.json .
+  mv ../warehouse/params.json ../warehouse/settings.json ../warehouse/tw_*.json ../warehouse/ui_*.json .
+  exit 1
+fi
+
+# パックに入れたファイルはアプリにコピーしない(postbuild.shで戻す)
+mkdir -p ../warehouse/packed
+grep -v '^#' ../tools/pack.txt | while read name method; do
+  case "$name" in
+    "") ;;
+    .*) for f in *"$name"; do [ -f "$f" ] && mv "$f" ../warehouse/packed; done ;;
+    *)  [ -f "$name" ] && mv "$name" ../warehouse/packed ;;
+  esac
+done